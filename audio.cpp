@@ -1,75 +1,248 @@
 #include "audio.h"
 #include "pico/stdlib.h" // Included for __not_in_flash_func if needed, though might be indirect
 #include "FrensHelpers.h" // Provides the global dvi_ pointer
-#include "screen_output.h"          // Provides the dvi::DVI class definition
+#include "screen_dispatch.h"     // Static dispatch to the backend
+#include "audio_rate.h"
+#include "audio_sink.h"
 #include <algorithm>    // For std::min
 
+// --- 2A03 non-linear mixer ---
+// Lookup tables in RAM, each entry a stereo pair packed as (right << 16) | left,
+// so one sample is two loads and an add. Both halves stay below 0x8000, the add
+// never carries from left into right.
+
+// pulse_out = 95.52 / (8128 / (p1 + p2) + 100), indexed by p1 * 16 + p2.
+// Pulse 1 leans left and pulse 2 right (2:1), as in the old mixer.
+DWORD SoundPulseMix[16 * 16];
+
+// tnd_out = 163.67 / (24329 / (3 * t + 2 * n + d) + 100), centred
+DWORD SoundTndMix[203];
+
+namespace
+{
+    // Output level at full scale, about as loud as the old linear weights
+    constexpr float MIX_SCALE = 8192.0f;
+
+    DWORD packStereo(float l, float r)
+    {
+        return static_cast<DWORD>(l * MIX_SCALE + 0.5f) |
+               (static_cast<DWORD>(r * MIX_SCALE + 0.5f) << 16);
+    }
+
+    static_assert(sizeof(ScreenOutput::AudioSample) == sizeof(DWORD),
+                  "packed stereo frames are written straight into the ring");
+
+    // The HDMI audio stream runs at 44.1 kHz. At lower APU rates each
+    // frame is staged, then written as upsample_ frames stepping linearly
+    // from the previous one. That leaves images of every tone f at
+    // rate - f and above, also for BLEP output: at 22050 Hz a 2 kHz tone's
+    // image is 34 dB down, a 5 kHz one's 17 dB ( host/test_upsample.cpp ).
+    constexpr int OUTPUT_RATE = 44100;
+    constexpr int STAGE_SIZE = 735 / 2 + 1; // Half a frame at 44.1 kHz
+    int upsample_ = 1;
+    DWORD stage_[STAGE_SIZE];
+    DWORD last_;
+
+    // Keeps the ring near half full, see audio_rate.h
+    AudioRateControl rate_;
+    int32_t capacity_;
+    int32_t fill_;
+    uint32_t underruns_;
+    uint32_t overruns_;
+
+    // Whether there is a ring to write to: the HDMI audio stream, or the
+    // PWM sink on SPI screens built with AUDIO_PWM_PIN
+    bool haveRing()
+    {
+#if defined(AUDIO_SINK)
+        return true;
+#elif defined(SPI_SCREEN)
+        return false;
+#else
+        return dvi_ != nullptr;
+#endif
+    }
+
+    __force_inline util::RingBuffer<ScreenOutput::AudioSample> &outputRing()
+    {
+#if defined(AUDIO_SINK)
+        return audio_sink_get_ring();
+#else
+        return screen::getAudioRingBuffer();
+#endif
+    }
+}
+
 // --- Implementation of InfoNES Sound API ---
 
 void InfoNES_SoundInit()
 {
-    // Currently empty in main.cpp
+    for (int p1 = 0; p1 < 16; ++p1)
+    {
+        for (int p2 = 0; p2 < 16; ++p2)
+        {
+            float l = 0, r = 0;
+            if (p1 + p2)
+            {
+                float out = 95.52f / (8128.0f / (p1 + p2) + 100.0f);
+                l = out * (2 * p1 + p2) / (1.5f * (p1 + p2));
+                r = out * (p1 + 2 * p2) / (1.5f * (p1 + p2));
+            }
+            SoundPulseMix[p1 * 16 + p2] = packStereo(l, r);
+        }
+    }
+
+    for (int i = 0; i < 203; ++i)
+    {
+        float out = i ? 163.67f / (24329.0f / i + 100.0f) : 0.0f;
+        SoundTndMix[i] = packStereo(out, out);
+    }
 }
 
 int InfoNES_SoundOpen(int samples_per_sync, int sample_rate)
 {
-    // Currently returns 0 in main.cpp
+    // The ring plays at OUTPUT_RATE, slower APU rates are stretched to it
+    upsample_ = std::max(1, OUTPUT_RATE / sample_rate);
+
+    // Nothing is queued yet, every free slot is the ring size
+#if defined(AUDIO_SINK)
+    audio_sink_start(OUTPUT_RATE);
+#endif
+    capacity_ = haveRing() ? outputRing().getFullWritableSize() : 0;
+    rate_.reset(capacity_);
+    fill_ = 0;
+    underruns_ = 0;
+    overruns_ = 0;
     return 0;
 }
 
 void InfoNES_SoundClose()
 {
-    // Currently empty in main.cpp
+#if defined(AUDIO_SINK)
+    audio_sink_stop();
+#endif
 }
 
 // Place in RAM because it's called often from the sound generation loop
 int __not_in_flash_func(InfoNES_GetSoundBufferSize)()
 {
-#ifdef SPI_SCREEN
-    return 0;
-#endif
-    // Requires dvi_
-    if (!dvi_) return 0; // Safety check
-    return dvi_->getAudioRingBuffer().getFullWritableSize();
+    if (!haveRing()) return 0; // Safety check
+    return outputRing().getFullWritableSize() / upsample_;
 }
 
 // Place in RAM because it's called often from the sound generation loop
 void __not_in_flash_func(InfoNES_SoundOutput)(int samples, BYTE *wave1, BYTE *wave2, BYTE *wave3, BYTE *wave4, BYTE *wave5)
 {
-#ifdef SPI_SCREEN
-    return;
-#endif
-    // Requires dvi_
-    if (!dvi_) return; // Safety check
-
     while (samples)
     {
-        auto &ring = dvi_->getAudioRingBuffer();
-        auto n = std::min<int>(samples, ring.getWritableSize());
+        int n;
+        DWORD *p = InfoNES_SoundLockBuffer(samples, &n);
         if (!n)
         {
-            // Buffer full, drop samples for now
-            // Alternatively, could block, but that might stall the emulator
+            // Buffer full, the rest is dropped (counted by the lock)
             return;
         }
-        auto p = ring.getWritePointer();
 
         int ct = n;
         while (ct--)
         {
-            // Mixing logic copied from main.cpp
-            int w1 = *wave1++;
-            int w2 = *wave2++;
-            int w3 = *wave3++;
-            int w4 = *wave4++;
-            int w5 = *wave5++;
-            // Original comment: w3 = w2 = w4 = w5 = 0;
-            int l = w1 * 6 + w2 * 3 + w3 * 5 + w4 * 3 * 17 + w5 * 2 * 32;
-            int r = w1 * 3 + w2 * 6 + w3 * 5 + w4 * 3 * 17 + w5 * 2 * 32;
-            *p++ = {static_cast<short>(l), static_cast<short>(r)};
+            // DAC levels: pulse, triangle and noise 0..15, DPCM 0..127
+            int p1 = *wave1++;
+            int p2 = *wave2++;
+            int t = *wave3++;
+            int ns = *wave4++;
+            int d = *wave5++;
+            *p++ = SoundPulseMix[p1 * 16 + p2] + SoundTndMix[3 * t + 2 * ns + d];
         }
 
-        ring.advanceWritePointer(n);
+        InfoNES_SoundUnlockBuffer(n);
         samples -= n;
     }
-} 
\ No newline at end of file
+}
+
+// Place in RAM because it's called from the sound generation loop
+DWORD *__not_in_flash_func(InfoNES_SoundLockBuffer)(int samples, int *locked)
+{
+    if (!haveRing()) // Safety check
+    {
+        *locked = 0;
+        return nullptr;
+    }
+
+    auto &ring = outputRing();
+    DWORD *p;
+    if (upsample_ > 1)
+    {
+        // Frames are stretched into the ring on unlock
+        *locked = std::min<int>({samples, STAGE_SIZE, static_cast<int>(ring.getFullWritableSize() / upsample_)});
+        p = stage_;
+    }
+    else
+    {
+        *locked = std::min<int>(samples, ring.getWritableSize());
+        p = reinterpret_cast<DWORD *>(ring.getWritePointer());
+    }
+    if (!*locked)
+    {
+        // Ring full, the caller drops what is left of the batch
+        overruns_ += samples;
+    }
+    return p;
+}
+
+void __not_in_flash_func(InfoNES_SoundUnlockBuffer)(int samples)
+{
+    auto &ring = outputRing();
+    if (upsample_ == 1)
+    {
+        ring.advanceWritePointer(samples);
+        return;
+    }
+
+    // Each frame becomes upsample_ frames ramping from the one before
+    int total = samples * upsample_;
+    int o = 0;
+    while (o < total)
+    {
+        int n = std::min<int>(ring.getWritableSize(), total - o);
+        if (!n)
+            break;
+
+        auto p = ring.getWritePointer();
+        for (int j = 0; j < n; ++j, ++o)
+        {
+            int f = o / upsample_;
+            int k = o % upsample_ + 1;
+            DWORD from = f ? stage_[f - 1] : last_;
+            DWORD to = stage_[f];
+            int l0 = static_cast<int16_t>(from & 0xffff), r0 = static_cast<int16_t>(from >> 16);
+            int l1 = static_cast<int16_t>(to & 0xffff), r1 = static_cast<int16_t>(to >> 16);
+            *p++ = {static_cast<int16_t>(l0 + (l1 - l0) * k / upsample_),
+                    static_cast<int16_t>(r0 + (r1 - r0) * k / upsample_)};
+        }
+        ring.advanceWritePointer(n);
+    }
+    if (samples)
+        last_ = stage_[samples - 1];
+}
+
+// Called by the pAPU once per Vsync
+int InfoNES_SoundRateTrim()
+{
+    if (!capacity_)
+        return 0;
+
+    fill_ = capacity_ - static_cast<int32_t>(outputRing().getFullWritableSize());
+    if (fill_ <= 0)
+        ++underruns_;
+    return rate_.update(fill_);
+}
+
+void audio_get_stats(AudioStats &stats)
+{
+    stats.fill = fill_;
+    stats.capacity = capacity_;
+    stats.trim = rate_.trim();
+    stats.underruns = underruns_;
+    stats.overruns = overruns_;
+}
@@ -1,6 +1,7 @@
 #ifndef AUDIO_H
 #define AUDIO_H
 
+#include <stdint.h>
 #include "InfoNES_Types.h" // For BYTE, WORD etc.
 
 // These are part of the InfoNES system API
@@ -11,5 +12,20 @@ int InfoNES_SoundOpen(int samples_per_sync, int sample_rate);
 void InfoNES_SoundClose(void);
 int InfoNES_GetSoundBufferSize();
 void InfoNES_SoundOutput(int samples, BYTE *wave1, BYTE *wave2, BYTE *wave3, BYTE *wave4, BYTE *wave5);
+DWORD *InfoNES_SoundLockBuffer(int samples, int *locked);
+void InfoNES_SoundUnlockBuffer(int samples);
+int InfoNES_SoundRateTrim(void);
+
+struct AudioStats
+{
+    int32_t fill;       // Frames queued in the ring at the last Vsync
+    int32_t capacity;   // Ring size in frames, 0 without HDMI audio
+    int32_t trim;       // Current sample rate trim in 1/65536ths
+    uint32_t underruns; // Vsyncs that found the ring empty
+    uint32_t overruns;  // APU samples dropped because the ring was full
+};
+
+// Running totals since InfoNES_SoundOpen().
+void audio_get_stats(AudioStats &stats);
 
 #endif // AUDIO_H 
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef AUDIO_RATE_H
+#define AUDIO_RATE_H
+
+#include <stdint.h>
+
+// Closed-loop control of the audio ring fill.
+//
+// The emulator is paced by its own frame timer, the ring is drained by the
+// HDMI audio clock. The two drift apart by a fraction of a percent, which
+// used to end in a full ring (dropped samples) or an empty one (gaps).
+// Once per frame update() looks at the ring fill and returns a trim for the
+// APU sample rate that steers the fill back to half the ring: a PI
+// controller, limited to +-TRIM_LIMIT so the pitch change stays inaudible.
+
+class AudioRateControl
+{
+public:
+    // Trims are in 1/65536ths of the nominal rate, 492 is 0.75 %
+    static constexpr int32_t TRIM_LIMIT = 492;
+
+    void reset(int32_t capacity)
+    {
+        capacity_ = capacity;
+        error_ = 0;
+        integral_ = 0;
+        trim_ = 0;
+    }
+
+    // fill: frames queued in the ring right now. Returns the new trim.
+    int32_t update(int32_t fill)
+    {
+        if (capacity_ <= 0)
+        {
+            return 0;
+        }
+
+        // Distance from half full in 1/65536ths of the ring, -32768..32768.
+        // The fill is read at a random point of the drain, average it over
+        // about 8 frames so the jitter does not reach the pitch.
+        int32_t error = (fill - capacity_ / 2) * 65536 / capacity_;
+        error_ += (error - error_) / 8;
+        error = error_;
+
+        // Full trim at half a ring off target, the integral removes the
+        // steady offset a constant drift leaves behind in a few seconds
+        integral_ += error;
+        if (integral_ > INTEGRAL_LIMIT)
+            integral_ = INTEGRAL_LIMIT;
+        if (integral_ < -INTEGRAL_LIMIT)
+            integral_ = -INTEGRAL_LIMIT;
+
+        int32_t trim = -(error * TRIM_LIMIT / 32768) -
+                       static_cast<int32_t>(static_cast<int64_t>(integral_) * TRIM_LIMIT / INTEGRAL_LIMIT);
+        if (trim > TRIM_LIMIT)
+            trim = TRIM_LIMIT;
+        if (trim < -TRIM_LIMIT)
+            trim = -TRIM_LIMIT;
+        trim_ = trim;
+        return trim;
+    }
+
+    int32_t trim() const { return trim_; }
+
+private:
+    // Integral that alone asks for the full trim
+    static constexpr int32_t INTEGRAL_LIMIT = 16384 * 240;
+
+    int32_t capacity_ = 0;
+    int32_t error_ = 0;
+    int32_t integral_ = 0;
+    int32_t trim_ = 0;
+};
+
+#endif // AUDIO_RATE_H
@@ -0,0 +1,228 @@
+#include "audio_sink.h"
+
+#if defined(AUDIO_SINK)
+#include <algorithm>
+#include "pico/stdlib.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#else
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#endif
+
+namespace
+{
+    // Frames per DMA half, about 5.8 ms at 44.1 kHz
+    constexpr int BUFFER_FRAMES = 256;
+
+    util::RingBuffer<ScreenOutput::AudioSample> ring_;
+    ScreenOutput::AudioSample last_{};
+    volatile uint32_t starved_;
+    bool started_ = false;
+
+    // Take count frames from the ring, holding the last one when it runs dry
+    void __not_in_flash_func(drain)(ScreenOutput::AudioSample *dst, int count)
+    {
+        while (count)
+        {
+            int n = std::min<int>(count, ring_.getReadableSize());
+            if (!n)
+            {
+                break;
+            }
+            auto p = ring_.getReadPointer();
+            std::copy(p, p + n, dst);
+            last_ = p[n - 1];
+            ring_.advanceReadPointer(n);
+            dst += n;
+            count -= n;
+        }
+        if (count)
+        {
+            starved_ += count;
+            std::fill(dst, dst + count, last_);
+        }
+    }
+
+#if PICO_ON_DEVICE
+    static_assert(AUDIO_PWM_PIN < 0 || (AUDIO_PWM_PIN & 1) == 0,
+                  "AUDIO_PWM_PIN must be even, left and right share one PWM slice");
+
+    // 10 bit PWM, a 246 kHz carrier at 252 MHz is far above the audio band
+    constexpr uint32_t PWM_WRAP = 1023;
+
+    uint32_t buffers_[2][BUFFER_FRAMES];
+    int channels_[2];
+
+    // The mixer peaks at about 8192 ( see audio.cpp ), BLEP ringing may dip below 0
+    inline uint32_t pwmLevel(int s)
+    {
+        return std::clamp(s / 8, 0, static_cast<int>(PWM_WRAP));
+    }
+
+    void __not_in_flash_func(refill)(int half)
+    {
+        ScreenOutput::AudioSample frames[BUFFER_FRAMES];
+        drain(frames, BUFFER_FRAMES);
+
+        // Slice compare register: channel A ( left ) low, channel B ( right ) high
+        uint32_t *dst = buffers_[half];
+        for (int i = 0; i < BUFFER_FRAMES; ++i)
+        {
+            dst[i] = pwmLevel(frames[i].l) | (pwmLevel(frames[i].r) << 16);
+        }
+    }
+
+    void __not_in_flash_func(dmaIrqHandler)()
+    {
+        // The finished channel was chained to the other one, rearm it for its next turn
+        for (int half = 0; half < 2; ++half)
+        {
+            int ch = channels_[half];
+            if (dma_channel_get_irq1_status(ch))
+            {
+                dma_channel_acknowledge_irq1(ch);
+                refill(half);
+                dma_channel_set_read_addr(ch, buffers_[half], false);
+            }
+        }
+    }
+
+    // DMA timer fraction closest to rate / clk_sys, both halves are 16 bit
+    void setTimerRate(int timer, uint32_t rate)
+    {
+        uint32_t clk = clock_get_hz(clk_sys);
+        uint32_t bestNum = 1, bestDen = 0xffff;
+        uint64_t bestErr = UINT64_MAX;
+        for (uint32_t den = 1; den <= 0xffff; ++den)
+        {
+            uint32_t num = (static_cast<uint64_t>(rate) * den + clk / 2) / clk;
+            if (num == 0 || num > 0xffff)
+            {
+                continue;
+            }
+            uint64_t actual = static_cast<uint64_t>(clk) * num / den;
+            uint64_t err = actual > rate ? actual - rate : rate - actual;
+            if (err < bestErr)
+            {
+                bestErr = err;
+                bestNum = num;
+                bestDen = den;
+            }
+        }
+        dma_timer_set_fraction(timer, bestNum, bestDen);
+    }
+#else
+    std::thread consumer_;
+    std::atomic<bool> stop_{false};
+    FILE *file_; // AUDIO_SINK_FILE, kept open across sessions
+
+    // Drains on the wall clock like the DMA would
+    void consume(int sample_rate)
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t consumed = 0;
+        ScreenOutput::AudioSample frames[BUFFER_FRAMES];
+        while (!stop_.load(std::memory_order_relaxed))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+            uint64_t due = static_cast<uint64_t>(us) * sample_rate / 1000000;
+            while (consumed < due)
+            {
+                int n = static_cast<int>(std::min<uint64_t>(due - consumed, BUFFER_FRAMES));
+                drain(frames, n);
+                if (file_)
+                {
+                    fwrite(frames, sizeof(frames[0]), n, file_);
+                }
+                consumed += n;
+            }
+        }
+    }
+#endif
+}
+
+void audio_sink_start(int sample_rate)
+{
+    if (started_)
+    {
+        return;
+    }
+    started_ = true;
+    ring_.resize(AUDIO_SINK_RING_SIZE);
+
+#if PICO_ON_DEVICE
+    uint slice = pwm_gpio_to_slice_num(AUDIO_PWM_PIN);
+    gpio_set_function(AUDIO_PWM_PIN, GPIO_FUNC_PWM);
+    gpio_set_function(AUDIO_PWM_PIN + 1, GPIO_FUNC_PWM);
+    pwm_config pwmConfig = pwm_get_default_config();
+    pwm_config_set_wrap(&pwmConfig, PWM_WRAP);
+    pwm_init(slice, &pwmConfig, true);
+
+    int timer = dma_claim_unused_timer(true);
+    setTimerRate(timer, sample_rate);
+
+    channels_[0] = dma_claim_unused_channel(true);
+    channels_[1] = dma_claim_unused_channel(true);
+    for (int half = 0; half < 2; ++half)
+    {
+        std::fill_n(buffers_[half], BUFFER_FRAMES, 0);
+        dma_channel_config c = dma_channel_get_default_config(channels_[half]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, dma_get_timer_dreq(timer));
+        channel_config_set_chain_to(&c, channels_[half ^ 1]);
+        dma_channel_configure(channels_[half], &c, &pwm_hw->slice[slice].cc,
+                              buffers_[half], BUFFER_FRAMES, false);
+        dma_channel_set_irq1_enabled(channels_[half], true);
+    }
+
+    // DMA_IRQ_0 belongs to the screen backends
+    irq_add_shared_handler(DMA_IRQ_1, dmaIrqHandler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+    dma_channel_start(channels_[0]);
+    printf("Audio sink: PWM on GPIO%d/%d at %d Hz\n", AUDIO_PWM_PIN, AUDIO_PWM_PIN + 1, sample_rate);
+#else
+    if (!file_ && getenv("AUDIO_SINK_FILE"))
+    {
+        file_ = fopen(getenv("AUDIO_SINK_FILE"), "wb");
+    }
+    consumer_ = std::thread(consume, sample_rate);
+#endif
+}
+
+void audio_sink_stop()
+{
+#if !PICO_ON_DEVICE
+    if (!started_)
+    {
+        return;
+    }
+    stop_ = true;
+    consumer_.join();
+    stop_ = false;
+    started_ = false;
+#endif
+}
+
+util::RingBuffer<ScreenOutput::AudioSample> &audio_sink_get_ring()
+{
+    return ring_;
+}
+
+uint32_t audio_sink_get_starved()
+{
+    return starved_;
+}
+#endif
@@ -0,0 +1,42 @@
+#ifndef AUDIO_SINK_H
+#define AUDIO_SINK_H
+
+#include <stdint.h>
+#include "screen_output.h"
+
+// Audio output for SPI screen builds, which have no HDMI audio stream.
+//
+// The sink owns a util::RingBuffer<AudioSample> like the one the DVI
+// backend drains, so audio.cpp writes to it the same way and its fill
+// feeds the rate controller. On the device the ring is drained by two
+// chained DMA channels into the compare register of one PWM slice, left
+// on AUDIO_PWM_PIN and right on the next pin, at a DMA timer paced rate.
+// Each channel refills its half from the ring in the DMA interrupt. When
+// the ring runs dry the last frame is held, the emulation core never
+// waits for the sink.
+// On the device the sink runs from the first start on, across games.
+// On the host (PICO_ON_DEVICE == 0) a thread drains the ring on the wall
+// clock and appends the frames to the file named by AUDIO_SINK_FILE, from
+// audio_sink_start() until audio_sink_stop() joins it.
+
+#ifndef AUDIO_PWM_PIN
+#define AUDIO_PWM_PIN -1
+#endif
+
+#ifndef AUDIO_SINK_RING_SIZE
+#define AUDIO_SINK_RING_SIZE 2048 // Frames, about 46 ms at 44.1 kHz, kept half full
+#endif
+
+// Start draining the ring at sample_rate frames per second. Calls while it runs do nothing.
+void audio_sink_start(int sample_rate);
+
+// Stop draining the ring. The device keeps its DMA running.
+void audio_sink_stop();
+
+// The ring audio.cpp writes to.
+util::RingBuffer<ScreenOutput::AudioSample> &audio_sink_get_ring();
+
+// Frames the sink had to hold because the ring was empty, since audio_sink_start().
+uint32_t audio_sink_get_starved();
+
+#endif // AUDIO_SINK_H
@@ -0,0 +1,120 @@
+#include "game_config.h"
+#include <stdio.h>
+#include <string.h>
+#include "ff.h"
+#include "FrensHelpers.h" // For GetfileNameFromFullPath, stripextensionfromfilename, GAMESAVEDIR
+
+namespace
+{
+    // On disk: magic, version, then the GameConfig fields
+    constexpr char CONFIG_MAGIC[4] = {'I', 'C', 'F', 'G'};
+    constexpr uint8_t CONFIG_VERSION = 1;
+
+    struct ConfigFile
+    {
+        char magic[4];
+        uint8_t version;
+        GameConfig config;
+    };
+
+    char *current_rom_full_path = nullptr;
+    GameConfig stored_{};
+    bool haveStored_ = false;
+
+    bool getConfigPath(char *path)
+    {
+        if (!current_rom_full_path || current_rom_full_path[0] == '\0')
+        {
+            printf("Game config: ROM name not set.\n");
+            return false;
+        }
+
+        char file_base_name[FF_MAX_LFN];
+        strcpy(file_base_name, Frens::GetfileNameFromFullPath(current_rom_full_path));
+        Frens::stripextensionfromfilename(file_base_name);
+        snprintf(path, FF_MAX_LFN, "%s/%s.CFG", GAMESAVEDIR, file_base_name);
+        return true;
+    }
+}
+
+void game_config_init(char *current_rom_name)
+{
+    current_rom_full_path = current_rom_name;
+    haveStored_ = false;
+}
+
+bool game_config_load(GameConfig &config)
+{
+    // Whatever is in effect now only gets written once it changes
+    stored_ = config;
+    haveStored_ = true;
+
+    char path[FF_MAX_LFN];
+    if (!getConfigPath(path))
+    {
+        return false;
+    }
+
+    FIL fil;
+    if (f_open(&fil, path, FA_READ) != FR_OK)
+    {
+        // No settings for this game yet
+        return false;
+    }
+
+    ConfigFile file;
+    size_t bytesRead = 0;
+    FRESULT fr = f_read(&fil, &file, sizeof(file), &bytesRead);
+    f_close(&fil);
+    if (fr != FR_OK || bytesRead != sizeof(file) ||
+        memcmp(file.magic, CONFIG_MAGIC, sizeof(CONFIG_MAGIC)) != 0 ||
+        file.version != CONFIG_VERSION)
+    {
+        printf("Game config: ignoring %s\n", path);
+        return false;
+    }
+
+    printf("Game config loaded from %s\n", path);
+    config = file.config;
+    stored_ = file.config;
+    return true;
+}
+
+void game_config_save(const GameConfig &config)
+{
+    if (haveStored_ && memcmp(&stored_, &config, sizeof(config)) == 0)
+    {
+        return;
+    }
+
+    char path[FF_MAX_LFN];
+    if (!getConfigPath(path))
+    {
+        return;
+    }
+
+    ConfigFile file;
+    memcpy(file.magic, CONFIG_MAGIC, sizeof(CONFIG_MAGIC));
+    file.version = CONFIG_VERSION;
+    file.config = config;
+
+    FIL fil;
+    FRESULT fr = f_open(&fil, path, FA_CREATE_ALWAYS | FA_WRITE);
+    if (fr != FR_OK)
+    {
+        printf("Game config: cannot open %s: %d\n", path, fr);
+        return;
+    }
+    size_t bytesWritten = 0;
+    fr = f_write(&fil, &file, sizeof(file), &bytesWritten);
+    f_close(&fil);
+    if (fr != FR_OK || bytesWritten != sizeof(file))
+    {
+        printf("Game config: error writing %s: %d\n", path, fr);
+        return;
+    }
+
+    printf("Game config saved to %s\n", path);
+    stored_ = config;
+    haveStored_ = true;
+}
@@ -0,0 +1,23 @@
+#ifndef GAME_CONFIG_H
+#define GAME_CONFIG_H
+
+#include <stdint.h>
+
+// Settings remembered per game, stored next to the save file as <rom>.CFG
+
+struct GameConfig
+{
+    uint8_t audioQuality; // pAPU quality tier, 0 is no sound
+};
+
+// Initialize the module with the name of the ROM being played
+void game_config_init(char *current_rom_name);
+
+// Load the settings of the current game, config holds the defaults.
+// Returns false and leaves config untouched when the game has none.
+bool game_config_load(GameConfig &config);
+
+// Save the settings of the current game when they differ from what was loaded
+void game_config_save(const GameConfig &config);
+
+#endif // GAME_CONFIG_H
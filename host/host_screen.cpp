@@ -0,0 +1,32 @@
+#include "host_screen.h"
+#include "FrensHelpers.h"
+
+// The backend the firmware creates at boot, set by whoever uses the stand-in
+ScreenOutput *dvi_;
+
+namespace host
+{
+    Screen::Screen()
+    {
+        for (auto &b : pool_)
+        {
+            b.resize(WIDTH);
+        }
+    }
+
+    ScreenOutput::LineBuffer *Screen::getLineBuffer()
+    {
+        auto p = &pool_[next_];
+        next_ = (next_ + 1) % POOL_LINES;
+        return p;
+    }
+
+    void Screen::setLineBuffer(int line, LineBuffer *p)
+    {
+        lines_.push_back({line, *p});
+        if (line == HEIGHT - 1)
+        {
+            ++frameCounter_;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef HOST_SCREEN_H
+#define HOST_SCREEN_H
+
+#include <vector>
+#include "screen_output.h"
+
+// Host stand-in for the screen backend, the third SCREEN_BACKEND_CLASS
+// beside dvi::DVI and the SPI panel ( see screen_dispatch.h ).
+//
+// getLineBuffer() hands out line buffers from a small pool and
+// setLineBuffer() keeps each line it is given, the frame counter advances
+// when the last visible line comes in. The audio ring is only filled,
+// the caller drains it. The control and conversion calls do nothing.
+
+namespace host
+{
+    class Screen : public ScreenOutput
+    {
+    public:
+        static constexpr int WIDTH = 320;   // Like the DVI line buffers
+        static constexpr int HEIGHT = 240;
+
+        struct Line
+        {
+            int line;
+            std::vector<uint16_t> pixels;
+        };
+
+        Screen();
+
+        LineBuffer *getLineBuffer() override;
+        void setLineBuffer(int line, LineBuffer *p) override;
+        void waitForValidLine() override {}
+        uint32_t getFrameCounter() const override { return frameCounter_; }
+
+        void registerIRQThisCore() override {}
+        void unregisterIRQThisCore() override {}
+        void start() override {}
+        void stop() override {}
+
+        BlankSettings &getBlankSettings() override { return blankSettings_; }
+        void setScanLine(bool enable) override {}
+
+        void setAudioFreq(int freq, int CTS, int N) override {}
+        void allocateAudioBuffer(size_t size) override { audioRing_.resize(size); }
+        util::RingBuffer<AudioSample> &getAudioRingBuffer() override { return audioRing_; }
+
+        void convertScanBuffer12bpp() override {}
+        void convertScanBuffer12bppScaled16_7(int srcPixelOfs, int dstPixelOfs, int dstPixels) override {}
+        void convertScanBuffer12bpp(uint16_t line, uint16_t *buffer, size_t size) override {}
+        void convertScanBuffer12bppScaled16_7(int srcPixelOfs, int dstPixelOfs, int dstPixels,
+                                              uint16_t line, uint16_t *buffer, size_t size) override {}
+
+        // Every line setLineBuffer() was given, oldest first
+        const std::vector<Line> &lines() const { return lines_; }
+
+    private:
+        static constexpr int POOL_LINES = 4;
+
+        LineBuffer pool_[POOL_LINES];
+        int next_ = 0;
+        uint32_t frameCounter_ = 0;
+        BlankSettings blankSettings_;
+        util::RingBuffer<AudioSample> audioRing_;
+        std::vector<Line> lines_;
+    };
+}
+
+#endif // HOST_SCREEN_H
@@ -0,0 +1,310 @@
+#include "host_system.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <initializer_list>
+#include "InfoNES.h"
+#include "InfoNES_System.h"
+#include "K6502.h"
+#include "xip_stats.h"
+#include "rom_cache.h"
+
+namespace
+{
+    constexpr int PRG_BANKS = 2; // 16K each
+    constexpr int CHR_BANKS = 1; // 8K each
+
+    BYTE rom_[16 + PRG_BANKS * 0x4000 + CHR_BANKS * 0x2000];
+    unsigned seed_;
+    unsigned padSeed_;
+    int frames_;
+    int maxFrames_;
+    uint64_t hash_;
+    WORD line_[NES_DISP_WIDTH];
+    std::vector<uint32_t> audio_;
+    DWORD ring_[4096];
+
+    unsigned next(unsigned &seed)
+    {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 8;
+    }
+
+    void mix(const void *p, size_t size)
+    {
+        auto b = static_cast<const BYTE *>(p);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash_ = (hash_ ^ b[i]) * 1099511628211ull;
+        }
+    }
+
+    // Code blocks of the main loop, CODE_BLOCK_SIZE bytes each: eight LDA
+    // absolute from the PRG and a JMP to the next block
+    constexpr int CODE_BLOCKS = 100;
+    constexpr int CODE_BLOCK_SIZE = 32;
+    constexpr int LOADS = 128; // Distinct PRG addresses the blocks read
+    constexpr WORD TILES = 0x8800; // $8800-$8BFF: name table bytes, $8C00-$8CFF: sprites
+
+    // Reset: fill the first name table and the sprites from the PRG, turn
+    // rendering on, then run the blocks in a loop forever.
+    void writeProgram(BYTE *prg)
+    {
+        BYTE *p = prg;
+        auto emit = [&p](std::initializer_list<int> bytes) {
+            for (int b : bytes)
+            {
+                *p++ = static_cast<BYTE>(b);
+            }
+        };
+        emit({0x78, 0xd8, 0xa2, 0xff, 0x9a});       // SEI CLD LDX #$FF TXS
+        emit({0xa9, 0x08, 0x8d, 0x00, 0x20});       // LDA #$08 STA $2000 ( sprites at $1000 )
+        emit({0xa9, 0x20, 0x8d, 0x06, 0x20});       // LDA #$20 STA $2006
+        emit({0xa9, 0x00, 0x8d, 0x06, 0x20});       // LDA #$00 STA $2006
+        emit({0xa2, 0x00});                         // LDX #0
+        for (int page = 0; page < 4; ++page)        // 1: LDA $88xx,X STA $2007 ...
+        {
+            emit({0xbd, 0x00, (TILES >> 8) + page, 0x8d, 0x07, 0x20});
+        }
+        emit({0xe8, 0xd0, 0x100 - 27});             // INX BNE 1
+        emit({0xbd, 0x00, (TILES >> 8) + 4});       // 2: LDA $8C00,X
+        emit({0x9d, 0x00, 0x02, 0xe8, 0xd0, 0xf7}); // STA $0200,X INX BNE 2
+        emit({0xa9, 0x02, 0x8d, 0x14, 0x40});       // LDA #$02 STA $4014
+        emit({0xa9, 0x1e, 0x8d, 0x01, 0x20});       // LDA #$1E STA $2001
+
+        // The blocks go to free slots anywhere in the PRG, in a random order,
+        // after the code so far and the JMP to the first one
+        int firstSlot = (p - prg + 3 + CODE_BLOCK_SIZE - 1) / CODE_BLOCK_SIZE;
+        int slots = PRG_BANKS * 0x4000 / CODE_BLOCK_SIZE - 1; // The last one holds the vectors
+        std::vector<int> order;
+        for (int slot = firstSlot; slot < slots; ++slot)
+        {
+            WORD addr = 0x8000 + slot * CODE_BLOCK_SIZE;
+            if (addr < TILES || addr >= TILES + 0x500)
+            {
+                order.push_back(slot);
+            }
+        }
+        for (int i = 0; i < CODE_BLOCKS; ++i)
+        {
+            std::swap(order[i], order[i + next(seed_) % (order.size() - i)]);
+        }
+        order.resize(CODE_BLOCKS);
+
+        WORD loads[LOADS];
+        for (auto &addr : loads)
+        {
+            addr = 0x8000 + next(seed_) % (PRG_BANKS * 0x4000);
+        }
+
+        auto slotAddr = [&order](int i) { return 0x8000 + order[i % CODE_BLOCKS] * CODE_BLOCK_SIZE; };
+        emit({0x4c, slotAddr(0) & 0xff, slotAddr(0) >> 8}); // JMP to the first block
+        for (int i = 0; i < CODE_BLOCKS; ++i)
+        {
+            p = prg + slotAddr(i) - 0x8000;
+            for (int j = 0; j < 8; ++j)
+            {
+                WORD addr = loads[next(seed_) % LOADS];
+                emit({0xad, addr & 0xff, addr >> 8});
+            }
+            emit({0x4c, slotAddr(i + 1) & 0xff, slotAddr(i + 1) >> 8});
+        }
+
+        // NMI, reset and IRQ all at $8000, NMIs stay off
+        memcpy(prg + PRG_BANKS * 0x4000 - 6, "\x00\x80\x00\x80\x00\x80", 6);
+    }
+}
+
+// Distinct colours, the hashes tell every palette index apart
+#define P(i) static_cast<WORD>((i) * 0x0421)
+#define P8(i) P(i), P(i + 1), P(i + 2), P(i + 3), P(i + 4), P(i + 5), P(i + 6), P(i + 7)
+const WORD NesPalette[64] = {P8(0), P8(8), P8(16), P8(24), P8(32), P8(40), P8(48), P8(56)};
+#undef P8
+#undef P
+
+HostRun host_run(int frames, unsigned seed)
+{
+    seed_ = seed;
+    padSeed_ = 12345;
+    frames_ = 0;
+    maxFrames_ = frames;
+    hash_ = 1469598103934665603ull;
+    InfoNES_Main();
+
+    BYTE regs[] = {PPU_R0, PPU_R1, PPU_R2, PPU_R3, PPU_R7};
+    mix(&K6502_State.PC, sizeof(K6502_State.PC));
+    mix(regs, sizeof(regs));
+    mix(&PPU_Addr, sizeof(PPU_Addr));
+    mix(&PPU_Temp, sizeof(PPU_Temp));
+    return {hash_, frames_};
+}
+
+std::vector<uint32_t> host_take_audio()
+{
+    return std::move(audio_);
+}
+
+int InfoNES_Menu()
+{
+    memcpy(rom_, "NES\x1a", 4);
+    rom_[4] = PRG_BANKS;
+    rom_[5] = CHR_BANKS;
+    for (size_t i = 16; i < sizeof(rom_); ++i)
+    {
+        rom_[i] = next(seed_);
+    }
+    BYTE *prg = rom_ + 16;
+    writeProgram(prg);
+
+    memcpy(&NesHeader, rom_, sizeof(NesHeader));
+    ROM = prg;
+    VROM = prg + PRG_BANKS * 0x4000;
+#if defined(XIP_STATS)
+    xip_stats_load();
+#endif
+#if defined(ROM_CACHE)
+    rom_cache_load();
+#endif
+    return InfoNES_Reset();
+}
+
+int InfoNES_ReadRom(const char *pszFileName)
+{
+    return 0;
+}
+
+void InfoNES_ReleaseRom()
+{
+#if defined(ROM_CACHE)
+    rom_cache_release();
+#endif
+    ROM = nullptr;
+    VROM = nullptr;
+}
+
+int InfoNES_LoadFrame()
+{
+#if defined(XIP_STATS)
+    xip_stats_frame();
+#endif
+    return 0;
+}
+
+void InfoNES_PadState(DWORD *pdwPad1, DWORD *pdwPad2, DWORD *pdwSystem)
+{
+    *pdwPad1 = next(padSeed_) & 0xff;
+    *pdwPad2 = next(padSeed_) & 0xff;
+    *pdwSystem = ++frames_ >= maxFrames_ ? PAD_SYS_QUIT : 0;
+}
+
+void InfoNES_PadLatch(DWORD *pdwPad1, DWORD *pdwPad2)
+{
+    *pdwPad1 = next(padSeed_) & 0xff;
+    *pdwPad2 = next(padSeed_) & 0xff;
+}
+
+bool InfoNES_IsLineVisible(int line)
+{
+    return true;
+}
+
+void InfoNES_PreDrawLine(int line)
+{
+    InfoNES_SetLineBuffer(line_, NES_DISP_WIDTH);
+}
+
+void InfoNES_PostDrawLine(int line)
+{
+    mix(line_, sizeof(line_));
+}
+
+#if defined(PPU_CORE1)
+CapturedLine *InfoNES_DeferDrawLine(int line)
+{
+    // Rendered in place, see test_ppu_core1.cpp for the capture
+    return nullptr;
+}
+
+void InfoNES_WaitDrawLine()
+{
+}
+#endif
+
+void InfoNES_DebugPrint(const char *pszMsg)
+{
+    printf("%s", pszMsg);
+}
+
+void InfoNES_MessageBox(const char *pszMsg, ...)
+{
+}
+
+void InfoNES_Error(const char *pszMsg, ...)
+{
+}
+
+// --- Sound, rendered at the APU rate and kept for host_take_audio() ---
+
+DWORD SoundPulseMix[16 * 16];
+DWORD SoundTndMix[203];
+
+void InfoNES_SoundInit()
+{
+    // Linear, the DAC level sums scaled to about the 2A03 mixer's full scale
+    for (int i = 0; i < 16 * 16; ++i)
+    {
+        SoundPulseMix[i] = ((i >> 4) + (i & 15)) * 100;
+    }
+    for (int i = 0; i < 203; ++i)
+    {
+        SoundTndMix[i] = i * 40;
+    }
+}
+
+int InfoNES_SoundOpen(int samples_per_sync, int sample_rate)
+{
+    audio_.clear();
+    return 0;
+}
+
+void InfoNES_SoundClose()
+{
+}
+
+int InfoNES_GetSoundBufferSize()
+{
+    return sizeof(ring_) / sizeof(ring_[0]);
+}
+
+DWORD *InfoNES_SoundLockBuffer(int samples, int *locked)
+{
+    *locked = std::min<int>(samples, InfoNES_GetSoundBufferSize());
+    return ring_;
+}
+
+void InfoNES_SoundUnlockBuffer(int samples)
+{
+    audio_.insert(audio_.end(), ring_, ring_ + samples);
+    mix(ring_, samples * sizeof(ring_[0]));
+}
+
+void InfoNES_SoundOutput(int samples, BYTE *wave1, BYTE *wave2, BYTE *wave3, BYTE *wave4, BYTE *wave5)
+{
+    while (samples)
+    {
+        int n;
+        DWORD *p = InfoNES_SoundLockBuffer(samples, &n);
+        for (int i = 0; i < n; ++i)
+        {
+            p[i] = SoundPulseMix[*wave1++ * 16 + *wave2++] + SoundTndMix[3 * *wave3++ + 2 * *wave4++ + *wave5++];
+        }
+        InfoNES_SoundUnlockBuffer(n);
+        samples -= n;
+    }
+}
+
+int InfoNES_SoundRateTrim()
+{
+    return 0;
+}
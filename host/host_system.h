@@ -0,0 +1,31 @@
+#ifndef HOST_SYSTEM_H
+#define HOST_SYSTEM_H
+
+#include <stdint.h>
+#include <vector>
+
+// InfoNES system layer for running the core on the host (PICO_ON_DEVICE == 0).
+//
+// host_run() plays a generated cartridge: mapper 0, two PRG banks and one
+// CHR bank of pseudo-random bytes. Its program fills a name table and the
+// sprites from the PRG, turns rendering on and then loops through blocks
+// of loads spread over the PRG, with pseudo-random pads. It is no game,
+// but a given seed drives the CPU and PPU through the same paths on
+// every run and every build, so builds with different options can be
+// compared by their hashes.
+// The sound layer keeps what the APU renders at its own sample rate,
+// mixed linearly into the left half of each frame.
+
+struct HostRun
+{
+    uint64_t hash; // FNV-1a over every rendered line and the final CPU and PPU state
+    int frames;
+};
+
+// Run InfoNES_Main() on the cartridge generated from seed until `frames` frames are done.
+HostRun host_run(int frames, unsigned seed);
+
+// Frames the APU rendered since the previous call, ( right << 16 ) | left.
+std::vector<uint32_t> host_take_audio();
+
+#endif // HOST_SYSTEM_H
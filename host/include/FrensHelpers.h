@@ -0,0 +1,13 @@
+#ifndef FRENSHELPERS_H
+#define FRENSHELPERS_H
+
+// Host stand-in for pico_shared's FrensHelpers.h, only the screen backend
+// pointer the dispatch in screen_dispatch.h goes through, and the host
+// backend class it may name, as the firmware's sees dvi::DVI.
+
+#include "screen_output.h"
+#include "host_screen.h"
+
+extern ScreenOutput *dvi_;
+
+#endif // FRENSHELPERS_H
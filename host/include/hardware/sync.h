@@ -0,0 +1,24 @@
+#ifndef HARDWARE_SYNC_H
+#define HARDWARE_SYNC_H
+
+// Host stand-in for the SDK's hardware/sync.h. The other core is a thread:
+// waiting for an event yields to it, events themselves are not needed.
+
+#include <atomic>
+#include <thread>
+
+inline void __wfe()
+{
+    std::this_thread::yield();
+}
+
+inline void __sev()
+{
+}
+
+inline void __dmb()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+#endif // HARDWARE_SYNC_H
@@ -0,0 +1,16 @@
+#ifndef PICO_H
+#define PICO_H
+
+// Host stand-in for the SDK's pico.h: there is no flash or scratch RAM to
+// place code and data in, the placement macros expand to plain declarations.
+
+#include <stdint.h>
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __scratch_x(group)
+#define __scratch_y(group)
+#define __force_inline inline __attribute__((always_inline))
+
+#endif // PICO_H
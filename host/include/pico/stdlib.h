@@ -0,0 +1,48 @@
+#ifndef PICO_STDLIB_H
+#define PICO_STDLIB_H
+
+// Host stand-in for the SDK's pico/stdlib.h, the microsecond timer runs on
+// the steady clock.
+
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#include "pico.h"
+#include "hardware/sync.h"
+
+typedef unsigned int uint;
+
+inline uint64_t time_us_64()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+inline uint32_t time_us_32()
+{
+    return static_cast<uint32_t>(time_us_64());
+}
+
+inline void sleep_us(uint64_t us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+inline void sleep_ms(uint32_t ms)
+{
+    sleep_us(ms * 1000ull);
+}
+
+inline void tight_loop_contents()
+{
+}
+
+// The emulation runs on the thread that calls InfoNES_Main()
+inline uint get_core_num()
+{
+    return 0;
+}
+
+#endif // PICO_STDLIB_H
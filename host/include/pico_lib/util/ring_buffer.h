@@ -0,0 +1,74 @@
+#ifndef UTIL_RING_BUFFER_H
+#define UTIL_RING_BUFFER_H
+
+// Host stand-in for pico_lib's ring buffer: one writer thread, one reader
+// thread, one slot kept free to tell full from empty. The get*Size()
+// calls without Full count up to the end of the storage only, so the
+// pointers they go with can be used for that many elements.
+
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace util
+{
+    template <class T>
+    class RingBuffer
+    {
+    public:
+        void resize(size_t size)
+        {
+            buffer_.resize(size);
+            read_ = 0;
+            write_ = 0;
+        }
+
+        size_t getFullWritableSize() const
+        {
+            return buffer_.empty() ? 0 : buffer_.size() - 1 - getFullReadableSize();
+        }
+
+        size_t getWritableSize() const
+        {
+            return std::min(getFullWritableSize(), buffer_.size() - write_);
+        }
+
+        T *getWritePointer()
+        {
+            return &buffer_[write_];
+        }
+
+        void advanceWritePointer(size_t n)
+        {
+            write_.store((write_ + n) % buffer_.size(), std::memory_order_release);
+        }
+
+        size_t getFullReadableSize() const
+        {
+            return buffer_.empty() ? 0 : (write_ + buffer_.size() - read_) % buffer_.size();
+        }
+
+        size_t getReadableSize() const
+        {
+            return std::min(getFullReadableSize(), buffer_.size() - read_);
+        }
+
+        const T *getReadPointer() const
+        {
+            return &buffer_[read_];
+        }
+
+        void advanceReadPointer(size_t n)
+        {
+            read_.store((read_ + n) % buffer_.size(), std::memory_order_release);
+        }
+
+    private:
+        std::vector<T> buffer_;
+        std::atomic<size_t> read_{0};
+        std::atomic<size_t> write_{0};
+    };
+}
+
+#endif // UTIL_RING_BUFFER_H
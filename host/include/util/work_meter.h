@@ -0,0 +1,25 @@
+#ifndef UTIL_WORK_METER_H
+#define UTIL_WORK_METER_H
+
+// Host stand-in for pico_lib's work meter, which samples a hardware timer.
+// Marks cost nothing and nothing is ever drawn.
+
+#include <stdint.h>
+
+namespace util
+{
+    inline void WorkMeterMark(uint32_t)
+    {
+    }
+
+    inline void WorkMeterReset()
+    {
+    }
+
+    template <class F>
+    void WorkMeterEnum(int, int, F)
+    {
+    }
+}
+
+#endif // UTIL_WORK_METER_H
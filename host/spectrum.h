@@ -0,0 +1,72 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <math.h>
+#include <complex>
+#include <vector>
+
+// Spectra for the audio checks: Hann windowed, mean removed, radix 2 FFT.
+
+namespace spectrum
+{
+    // In place, the size a power of two
+    inline void fft(std::vector<std::complex<double>> &a)
+    {
+        int n = a.size();
+        for (int i = 1, j = 0; i < n; ++i)
+        {
+            int bit = n >> 1;
+            for (; j & bit; bit >>= 1)
+            {
+                j ^= bit;
+            }
+            j ^= bit;
+            if (i < j)
+            {
+                std::swap(a[i], a[j]);
+            }
+        }
+        for (int len = 2; len <= n; len <<= 1)
+        {
+            auto w = std::polar(1.0, -2 * M_PI / len);
+            for (int i = 0; i < n; i += len)
+            {
+                std::complex<double> wk = 1;
+                for (int k = 0; k < len / 2; ++k, wk *= w)
+                {
+                    auto u = a[i + k];
+                    auto v = a[i + k + len / 2] * wk;
+                    a[i + k] = u + v;
+                    a[i + k + len / 2] = u - v;
+                }
+            }
+        }
+    }
+
+    // Power of bins 0 to n / 2 of the n samples from first
+    template <typename It>
+    std::vector<double> power(It first, int n)
+    {
+        double mean = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            mean += first[i];
+        }
+        mean /= n;
+        std::vector<std::complex<double>> x(n);
+        for (int i = 0; i < n; ++i)
+        {
+            double w = 0.5 - 0.5 * cos(2 * M_PI * i / n);
+            x[i] = (first[i] - mean) * w;
+        }
+        fft(x);
+        std::vector<double> p(n / 2 + 1);
+        for (int k = 0; k <= n / 2; ++k)
+        {
+            p[k] = std::norm(x[k]);
+        }
+        return p;
+    }
+}
+
+#endif // SPECTRUM_H
@@ -0,0 +1,136 @@
+// Aliasing of the APU's band-limited steps ( BLEP, pAPU_QUALITY 4 and 5 ).
+//
+// A steady pulse or triangle tone is rendered at 22050 Hz with and without
+// BLEP, and at 44100 Hz without. The power of the spectrum below 10 kHz
+// that is not at a harmonic of the tone ( Hann window, 8192 points ) is
+// the alias, reported relative to the harmonics. With BLEP the alias must
+// be well below that of the plain steps at the same rate. This is the
+// output at the render rate, test_upsample covers its stretch to 44.1 kHz.
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "InfoNES.h"
+#include "InfoNES_pAPU.h"
+#include "K6502.h"
+#include "host_system.h"
+#include "spectrum.h"
+
+// Phase steps of pulse 1 and the triangle, 2^29 a sample per cycle ( InfoNES_pAPU.cpp )
+extern DWORD ApuC1Skip;
+extern DWORD ApuC3Skip;
+
+namespace
+{
+    constexpr int N = 8192;          // Points of the spectrum
+    constexpr int SETTLE = 2000;     // Samples dropped first
+    constexpr double BAND = 10000;   // Hz
+    constexpr double MAX_BLEP_DB = -30;
+    constexpr double MIN_GAIN_DB = 15; // BLEP against the plain steps at the same rate
+
+    // pAPU_QUALITY values and their sample rates
+    struct Quality
+    {
+        int quality;
+        int rate;
+    };
+
+    constexpr Quality PLAIN_22050 = {2, 22050};
+    constexpr Quality PLAIN_44100 = {3, 44100};
+    constexpr Quality BLEP_22050 = {5, 22050};
+
+    struct Tone
+    {
+        const char *name;
+        bool triangle;
+        int period; // Timer period, the register value
+    };
+
+    int failed_;
+
+    // Alias power relative to the harmonics of the tone, dB
+    double render(const Tone &tone, const Quality &quality, double &f0)
+    {
+        InfoNES_pAPUSetQuality(quality.quality);
+        InfoNES_pAPUInit();
+
+        int p = tone.period;
+        if (tone.triangle)
+        {
+            ApuWriteControl(0x4015, 0x04);
+            pAPUSoundRegs[8](0x4008, 0xff); // Linear counter held
+            pAPUSoundRegs[10](0x400a, p & 0xff);
+            pAPUSoundRegs[11](0x400b, (p >> 8) | 0xf8);
+        }
+        else
+        {
+            ApuWriteControl(0x4015, 0x01);
+            pAPUSoundRegs[0](0x4000, 0xbf); // 50% duty, length held, volume 15
+            pAPUSoundRegs[1](0x4001, 0x08); // No sweep
+            pAPUSoundRegs[2](0x4002, p & 0xff);
+            pAPUSoundRegs[3](0x4003, (p >> 8) | 0xf8);
+        }
+
+        host_take_audio();
+        std::vector<uint32_t> audio;
+        while (static_cast<int>(audio.size()) < SETTLE + N)
+        {
+            for (int line = 0; line < 262; ++line)
+            {
+                K6502_State.g_wCurrentClocks += 114;
+                InfoNES_pAPUHsync(true);
+                if (line == 241)
+                {
+                    InfoNES_pAPUVsync();
+                }
+            }
+            auto frame = host_take_audio();
+            audio.insert(audio.end(), frame.begin(), frame.end());
+        }
+
+        // The pitch the channel really has, its phase step is rounded. The
+        // writes above are queued, it is only known once they are replayed
+        DWORD skip = tone.triangle ? ApuC3Skip : ApuC1Skip;
+        f0 = skip * static_cast<double>(quality.rate) / (1u << 29);
+
+        std::vector<int16_t> left(audio.begin() + SETTLE, audio.begin() + SETTLE + N);
+        auto power = spectrum::power(left.begin(), N);
+
+        int fs = quality.rate;
+        double signal = 0;
+        double alias = 0;
+        for (int k = 1; k < N / 2 && static_cast<double>(k) * fs / N <= BAND; ++k)
+        {
+            double f = static_cast<double>(k) * fs / N;
+            double h = round(f / f0);
+            // The Hann window spreads a line over a few bins
+            bool harmonic = h >= 1 && fabs(f - h * f0) < 3.0 * fs / N;
+            (harmonic ? signal : alias) += power[k];
+        }
+        return 10 * log10(alias / signal);
+    }
+}
+
+int main()
+{
+    const Tone tones[] = {
+        {"pulse", false, 63},
+        {"pulse", false, 17},
+        {"triangle", true, 47},
+        {"triangle", true, 23},
+    };
+
+    printf("                   44100 plain  22050 plain  22050 BLEP\n");
+    for (auto &tone : tones)
+    {
+        double f0;
+        double plain44 = render(tone, PLAIN_44100, f0);
+        double plain22 = render(tone, PLAIN_22050, f0);
+        double blep22 = render(tone, BLEP_22050, f0);
+        bool ok = blep22 <= MAX_BLEP_DB && blep22 <= plain22 - MIN_GAIN_DB;
+        printf("%-8s %5.0f Hz   %7.1f dB   %7.1f dB   %7.1f dB  %s\n",
+               tone.name, f0, plain44, plain22, blep22, ok ? "ok" : "FAILED");
+        failed_ += !ok;
+    }
+    return failed_;
+}
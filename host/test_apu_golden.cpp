@@ -0,0 +1,226 @@
+// APU regression: a fixed register write script over all five channels
+// ( envelopes, sweeps, length and linear counters, both noise modes,
+// looping DPCM streamed from a ROM bank ) rendered at every quality and
+// compared sample for sample with golden/apu_script.s16.
+//
+// The golden buffer holds 16 bit little endian samples, the qualities one
+// after the other. Each quality starts from the channel state the one
+// before left, the triangle sequencer survives InfoNES_pAPUInit() as on
+// the console, so quality 3 goes first from a clean state.
+// `test_apu_golden --update` writes it from this tree, only do that for a
+// change that is meant to alter the output.
+//
+// Also built with APU_SPLIT_CHANNELS, which must give the same samples.
+// That path has no BLEP, qualities 4 and 5 are not compared there. And
+// with APU_CORE1, where a second thread renders the published batches.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#if defined(APU_CORE1)
+#include <atomic>
+#include <thread>
+#endif
+#include "InfoNES.h"
+#include "InfoNES_pAPU.h"
+#include "K6502.h"
+#include "host_system.h"
+
+namespace
+{
+    constexpr int FRAMES = 16;
+    constexpr int QUALITIES[] = {3, 1, 2, 4, 5};
+
+    struct Write
+    {
+        int frame;
+        int line;
+        WORD addr;
+        BYTE data;
+    };
+
+    const Write SCRIPT[] = {
+        {0, 0, 0x4015, 0x0f},
+        {0, 0, 0x4000, 0x84}, // Pulse 1: 50% duty, envelope decay, period 4
+        {0, 0, 0x4001, 0xa2}, // Sweep up, period 3, shift 2
+        {0, 0, 0x4002, 0xfd},
+        {0, 0, 0x4003, 0x01},
+        {0, 0, 0x4004, 0x7a}, // Pulse 2: 25% duty, held, volume 10
+        {0, 0, 0x4005, 0x08},
+        {0, 0, 0x4006, 0x52},
+        {0, 0, 0x4007, 0xf8},
+        {0, 0, 0x4008, 0x30}, // Triangle: linear counter 48
+        {0, 0, 0x400a, 0x9f},
+        {0, 0, 0x400b, 0x02},
+        {2, 100, 0x4003, 0x09}, // Pulse 1 restarted mid-frame, length 8
+        {4, 0, 0x400c, 0x1c}, // Noise: long mode, held, volume 12
+        {4, 0, 0x400e, 0x04},
+        {4, 0, 0x400f, 0x08},
+        {6, 0, 0x4010, 0x4e}, // DPCM: looping, rate 14, from $C040, 145 bytes
+        {6, 0, 0x4011, 0x40},
+        {6, 0, 0x4012, 0x01},
+        {6, 0, 0x4013, 0x09},
+        {6, 0, 0x4015, 0x1f},
+        {8, 0, 0x400e, 0x86}, // Noise: short mode
+        {8, 130, 0x400c, 0x03}, // Envelope decay, period 4
+        {9, 0, 0x400f, 0x18},
+        {10, 0, 0x4015, 0x1d}, // Pulse 2 off
+        {11, 200, 0x4011, 0x10}, // DPCM level jump while it loops
+        {12, 0, 0x4006, 0x20}, // Pulse 2 back on, new period
+        {12, 0, 0x4007, 0x09},
+        {12, 0, 0x4015, 0x1f},
+        {13, 50, 0x4008, 0x81}, // Triangle: control set, linear counter 1
+        {13, 50, 0x400b, 0x01},
+        {14, 0, 0x4010, 0x0f}, // DPCM: not looping, fastest rate
+        {14, 0, 0x4015, 0x1b}, // Pulse 2 off, DPCM restarted
+    };
+
+    BYTE prg_[4][0x2000]; // The DPCM bytes come from ROMBANK2
+
+    void write(WORD addr, BYTE data)
+    {
+        if (addr == 0x4015)
+        {
+            ApuWriteControl(addr, data);
+        }
+        else
+        {
+            pAPUSoundRegs[addr & 0x1f](addr, data);
+        }
+    }
+
+    std::vector<int16_t> render(int quality)
+    {
+        unsigned seed = 1;
+        for (auto &bank : prg_)
+        {
+            for (auto &b : bank)
+            {
+                seed = seed * 1103515245 + 12345;
+                b = seed >> 16;
+            }
+        }
+        for (int i = 0; i < 4; ++i)
+        {
+            ROMBANK[i] = prg_[i];
+        }
+
+        InfoNES_pAPUSetQuality(quality);
+        InfoNES_pAPUInit();
+        host_take_audio();
+
+        std::vector<int16_t> out;
+        const Write *next = SCRIPT;
+        const Write *end = SCRIPT + sizeof(SCRIPT) / sizeof(SCRIPT[0]);
+        for (int frame = 0; frame < FRAMES; ++frame)
+        {
+            for (int line = 0; line < 262; ++line)
+            {
+                for (; next != end && next->frame == frame && next->line == line; ++next)
+                {
+                    write(next->addr, next->data);
+                }
+                K6502_State.g_wCurrentClocks += 114;
+                InfoNES_pAPUHsync(true);
+                if (line == 241)
+                {
+                    InfoNES_pAPUVsync();
+                }
+            }
+#if defined(APU_CORE1)
+            InfoNES_pAPUDrain();
+#endif
+            for (uint32_t v : host_take_audio())
+            {
+                out.push_back(static_cast<int16_t>(v));
+            }
+        }
+        return out;
+    }
+}
+
+int main(int argc, char **argv)
+{
+#if defined(APU_CORE1)
+    std::atomic<bool> stop{false};
+    std::thread core1([&stop] {
+        while (!stop)
+        {
+            if (!InfoNES_pAPUService())
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+#endif
+    std::vector<int16_t> samples;
+    std::vector<size_t> starts;
+    for (int quality : QUALITIES)
+    {
+        starts.push_back(samples.size());
+        auto q = render(quality);
+        printf("quality %d: %zu samples\n", quality, q.size());
+        samples.insert(samples.end(), q.begin(), q.end());
+    }
+    starts.push_back(samples.size());
+#if defined(APU_CORE1)
+    stop = true;
+    core1.join();
+#endif
+
+    std::vector<BYTE> bytes;
+    for (int16_t s : samples)
+    {
+        bytes.push_back(s & 0xff);
+        bytes.push_back((s >> 8) & 0xff);
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "--update"))
+    {
+        FILE *f = fopen(APU_GOLDEN, "wb");
+        if (!f || fwrite(bytes.data(), 1, bytes.size(), f) != bytes.size())
+        {
+            printf("FAILED: cannot write %s\n", APU_GOLDEN);
+            return 1;
+        }
+        fclose(f);
+        printf("wrote %s\n", APU_GOLDEN);
+        return 0;
+    }
+
+    std::vector<BYTE> golden(bytes.size() + 1);
+    FILE *f = fopen(APU_GOLDEN, "rb");
+    size_t size = f ? fread(golden.data(), 1, golden.size(), f) : 0;
+    if (f)
+    {
+        fclose(f);
+    }
+    if (size != bytes.size())
+    {
+        printf("FAILED: %s holds %zu bytes, the script renders %zu\n", APU_GOLDEN, size, bytes.size());
+        return 1;
+    }
+
+    int failed = 0;
+    for (size_t q = 0; q + 1 < starts.size(); ++q)
+    {
+#if defined(APU_SPLIT_CHANNELS)
+        if (QUALITIES[q] >= 4)
+        {
+            continue;
+        }
+#endif
+        for (size_t i = starts[q]; i < starts[q + 1]; ++i)
+        {
+            int16_t want = golden[2 * i] | golden[2 * i + 1] << 8;
+            if (samples[i] != want)
+            {
+                printf("FAILED: quality %d sample %zu is %d, golden %d\n",
+                       QUALITIES[q], i - starts[q], samples[i], want);
+                ++failed;
+                break;
+            }
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,120 @@
+// AudioRateControl ( audio_rate.h ) against a simulated consumer clock.
+//
+// The APU side is simulated as the firmware runs it. Each frame takes its
+// trim from the fill at Vsync. It then adds its samples in four batches
+// ( 66, 66, 66 and 64 lines ) at 1.003 * 44100 / 60 samples a frame,
+// scaled by the trim. The consumer drains the ring continuously at
+// 44100 Hz, off by the given drift. The frame time jitters by +-300 us
+// against absolute deadlines.
+// After 30 s the ring must neither overflow nor run dry, and its fill
+// must stay within a quarter ring of the target. Each case runs for
+// 5 minutes of simulated time.
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include "audio_rate.h"
+
+namespace
+{
+    constexpr int FRAMES = 60 * 300;
+    constexpr int SETTLED = 60 * 30;                // Frames before the checks start
+    constexpr unsigned SAMPLES_PER_SYNC_16 = 184402; // 44100 * 1.003 / 60 / 262 * 65536
+    constexpr double FRAME_US = 16639;
+
+    struct Case
+    {
+        double drift; // Consumer clock error, 0.001: 0.1 % fast
+        int capacity; // Ring size in frames
+        bool empty;   // Start with an empty ring instead of half full
+    };
+
+    struct Result
+    {
+        long under; // Frames the consumer missed after SETTLED
+        long over;  // Frames dropped after SETTLED
+        double maxDeviation;
+        int minTrim;
+        int maxTrim;
+    };
+
+    Result simulate(const Case &c)
+    {
+        AudioRateControl control;
+        control.reset(c.capacity);
+
+        Result r = {0, 0, 0, AudioRateControl::TRIM_LIMIT, -AudioRateControl::TRIM_LIMIT};
+        double fill = c.empty ? 0 : c.capacity / 2;
+        double rate = 44100.0 * (1 + c.drift) / 1e6; // Frames per us
+        unsigned long acc16 = 0;
+        unsigned seed = 7;
+        double jitter = 0;
+        for (int f = 0; f < FRAMES; ++f)
+        {
+            bool settled = f >= SETTLED;
+            int trim = control.update(static_cast<int>(fill));
+            if (settled)
+            {
+                r.minTrim = std::min(r.minTrim, trim);
+                r.maxTrim = std::max(r.maxTrim, trim);
+            }
+            unsigned perLine = SAMPLES_PER_SYNC_16 + static_cast<int>(SAMPLES_PER_SYNC_16) * trim / 65536;
+
+            seed = seed * 1103515245 + 12345;
+            double j = static_cast<double>((seed >> 16) % 600) - 300;
+            double frameUs = FRAME_US + j - jitter;
+            jitter = j;
+
+            for (int batch = 0; batch < 4; ++batch)
+            {
+                int lines = batch < 3 ? 66 : 64;
+                acc16 += static_cast<unsigned long>(perLine) * lines;
+                long n = acc16 >> 16;
+                acc16 -= n << 16;
+
+                fill -= rate * frameUs / 4;
+                if (fill < 0)
+                {
+                    r.under += settled ? static_cast<long>(-fill) : 0;
+                    fill = 0;
+                }
+                fill += n;
+                if (fill > c.capacity)
+                {
+                    r.over += settled ? static_cast<long>(fill - c.capacity) : 0;
+                    fill = c.capacity;
+                }
+            }
+            if (settled)
+            {
+                r.maxDeviation = std::max(r.maxDeviation, std::abs(fill - c.capacity / 2));
+            }
+        }
+        return r;
+    }
+}
+
+int main()
+{
+    const Case cases[] = {
+        {+0.0048, 1024, false},
+        {+0.0048, 4096, false},
+        {0, 1024, false},
+        {-0.0020, 4096, false},
+        {+0.0070, 1024, false},
+        {+0.0048, 1024, true},
+    };
+
+    int failed = 0;
+    printf("drift    ring  start  under  over  max dev  trim\n");
+    for (auto &c : cases)
+    {
+        Result r = simulate(c);
+        bool ok = !r.under && !r.over && r.maxDeviation < c.capacity / 4;
+        printf("%+.2f%%  %5d  %-5s  %5ld  %4ld  %7.0f  %d..%d  %s\n", c.drift * 100, c.capacity,
+               c.empty ? "empty" : "half", r.under, r.over, r.maxDeviation, r.minTrim, r.maxTrim,
+               ok ? "ok" : "FAILED");
+        failed += !ok;
+    }
+    return failed;
+}
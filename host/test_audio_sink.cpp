@@ -0,0 +1,111 @@
+// The audio sink ( AUDIO_SINK ) drained at the real rate, with audio.cpp
+// and its AudioRateControl steering the fill.
+//
+// The sink's host thread drains the ring at 44.1 kHz on the wall clock.
+// A producer stands in for the APU. It runs frames on absolute
+// FRAME_TIME_US deadlines like main.cpp, and writes each frame in four
+// batches of 66, 66, 66 and 64 lines at 44100 * 1.003 / 60 samples per
+// frame. That count is scaled by the trim InfoNES_SoundRateTrim() returns
+// at Vsync. Once the controller has settled, the sink must never starve,
+// no samples may be dropped, and the fill at Vsync must stay within
+// 3/8 of a ring of half full. The sink drains in 5 ms steps, so the fill
+// swings by about 220 frames on its own.
+// A second session follows, after InfoNES_SoundClose(). It checks that
+// the sink's thread is stopped and started again.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "audio.h"
+#include "audio_sink.h"
+
+namespace
+{
+    constexpr int FRAME_US = 16639;                  // main.cpp's FRAME_TIME_US
+    constexpr unsigned SAMPLES_PER_SYNC_16 = 184402; // 44100 * 1.003 / 60 / 262 * 65536
+    constexpr int SETTLE_FRAMES = 60;
+    constexpr int FRAMES = 200;
+
+    BYTE silence_[AUDIO_SINK_RING_SIZE];
+    int failed_;
+
+    struct Session
+    {
+        uint32_t starved;
+        uint32_t overruns;
+        int32_t minFill;
+        int32_t maxFill;
+        int32_t minTrim;
+        int32_t maxTrim;
+    };
+
+    Session play()
+    {
+        InfoNES_SoundOpen(735, 44100);
+
+        Session s = {0, 0, AUDIO_SINK_RING_SIZE, 0, 1 << 30, -(1 << 30)};
+        uint32_t starved0 = 0;
+        uint32_t overruns0 = 0;
+        unsigned long acc16 = 0;
+        int trim = 0;
+        auto deadline = std::chrono::steady_clock::now();
+        for (int f = 0; f < FRAMES; ++f)
+        {
+            unsigned perLine = SAMPLES_PER_SYNC_16 + static_cast<int>(SAMPLES_PER_SYNC_16) * trim / 65536;
+            for (int batch = 0; batch < 4; ++batch)
+            {
+                int lines = batch < 3 ? 66 : 64;
+                acc16 += static_cast<unsigned long>(perLine) * lines;
+                int n = acc16 >> 16;
+                acc16 -= static_cast<unsigned long>(n) << 16;
+                InfoNES_SoundOutput(n, silence_, silence_, silence_, silence_, silence_);
+                std::this_thread::sleep_until(deadline + std::chrono::microseconds(FRAME_US * (batch + 1) / 4));
+            }
+            deadline += std::chrono::microseconds(FRAME_US);
+
+            trim = InfoNES_SoundRateTrim();
+            AudioStats stats;
+            audio_get_stats(stats);
+            if (f == SETTLE_FRAMES)
+            {
+                starved0 = audio_sink_get_starved();
+                overruns0 = stats.overruns;
+            }
+            if (f >= SETTLE_FRAMES)
+            {
+                s.minFill = std::min(s.minFill, stats.fill);
+                s.maxFill = std::max(s.maxFill, stats.fill);
+                s.minTrim = std::min(s.minTrim, trim);
+                s.maxTrim = std::max(s.maxTrim, trim);
+            }
+        }
+        AudioStats stats;
+        audio_get_stats(stats);
+        s.starved = audio_sink_get_starved() - starved0;
+        s.overruns = stats.overruns - overruns0;
+
+        InfoNES_SoundClose();
+        return s;
+    }
+
+    void report(const char *name, const Session &s)
+    {
+        int32_t capacity = AUDIO_SINK_RING_SIZE - 1;
+        bool ok = !s.starved && !s.overruns &&
+                  s.minFill > capacity / 8 && s.maxFill < capacity * 7 / 8;
+        printf("%s: fill %d..%d of %d, trim %d..%d, %u frames starved, %u samples dropped  %s\n",
+               name, s.minFill, s.maxFill, capacity, s.minTrim, s.maxTrim, s.starved, s.overruns,
+               ok ? "ok" : "FAILED");
+        failed_ += !ok;
+    }
+}
+
+int main()
+{
+    InfoNES_SoundInit();
+    report("first session", play());
+    report("second session", play());
+    return failed_;
+}
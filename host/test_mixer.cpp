@@ -0,0 +1,69 @@
+// The 2A03 mixer tables of audio.cpp against the mixer formulas evaluated
+// in double precision, for every combination of the five DAC levels:
+//
+//   pulse_out = 95.52 / (8128 / (p1 + p2) + 100)
+//   tnd_out   = 163.67 / (24329 / (3 * t + 2 * n + d) + 100)
+//
+// pulse 1 panned 2:1 left and pulse 2 2:1 right, full scale 8192. The sum
+// of two table entries, as InfoNES_SoundOutput() makes it, must stay
+// within 1 LSB of the formula in both halves and below 0x8000 in each.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "audio.h"
+#include "InfoNES_System.h"
+
+namespace
+{
+    constexpr double SCALE = 8192;
+    constexpr double MAX_ERROR = 1.0; // LSB
+
+    double pulseOut(int p1, int p2)
+    {
+        return p1 + p2 ? 95.52 / (8128.0 / (p1 + p2) + 100) : 0;
+    }
+
+    double tndOut(int t, int n, int d)
+    {
+        int sum = 3 * t + 2 * n + d;
+        return sum ? 163.67 / (24329.0 / sum + 100) : 0;
+    }
+}
+
+int main()
+{
+    InfoNES_SoundInit();
+
+    double maxError = 0;
+    int overflows = 0;
+    for (int p1 = 0; p1 < 16; ++p1)
+    {
+        for (int p2 = 0; p2 < 16; ++p2)
+        {
+            double pulse = pulseOut(p1, p2);
+            double left = p1 + p2 ? pulse * (2 * p1 + p2) / (1.5 * (p1 + p2)) : 0;
+            double right = p1 + p2 ? pulse * (p1 + 2 * p2) / (1.5 * (p1 + p2)) : 0;
+            for (int t = 0; t < 16; ++t)
+            {
+                for (int n = 0; n < 16; ++n)
+                {
+                    for (int d = 0; d < 128; ++d)
+                    {
+                        double tnd = tndOut(t, n, d);
+                        DWORD v = SoundPulseMix[p1 * 16 + p2] + SoundTndMix[3 * t + 2 * n + d];
+                        uint32_t l = v & 0xffff;
+                        uint32_t r = v >> 16;
+                        overflows += l >= 0x8000 || r >= 0x8000;
+                        maxError = fmax(maxError, fabs(l - (left + tnd) * SCALE));
+                        maxError = fmax(maxError, fabs(r - (right + tnd) * SCALE));
+                    }
+                }
+            }
+        }
+    }
+
+    bool ok = maxError < MAX_ERROR && !overflows;
+    printf("largest error %.3f LSB, %d sums overflow 15 bits  %s\n", maxError, overflows, ok ? "ok" : "FAILED");
+    return !ok;
+}
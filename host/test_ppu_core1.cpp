@@ -0,0 +1,135 @@
+// PPU_CORE1: a line captured by InfoNES_CaptureLine() and rendered on
+// another thread must equal the line InfoNES_DrawLine() renders at once.
+//
+// Each round sets a random PPU state, renders it synchronously, then
+// captures the same state. The state is scribbled as the CPU would
+// change it before core 1 gets to the line: every register, the PPUBANK
+// pointers, the palette, the sprites and the live line buffer. Pattern
+// and name table memory stays unchanged, writes to it wait for core 1.
+// The captured line is then rendered on a second thread. The pixels must
+// match, and the capture must set the sprite overflow flag like the
+// synchronous render.
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include "InfoNES.h"
+#include "InfoNES_Mapper.h"
+
+namespace
+{
+    constexpr int ROUNDS = 20000;
+
+    unsigned seed_ = 7;
+
+    unsigned next()
+    {
+        seed_ = seed_ * 1103515245 + 12345;
+        return seed_ >> 8;
+    }
+
+    BYTE memory_[16 * 1024]; // Pattern and name tables the banks point into
+
+    void randomBanks()
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            PPUBANK[i] = memory_ + (next() % 16) * 1024;
+        }
+    }
+
+    void randomState()
+    {
+        randomBanks();
+        for (int i = 0; i < SPRRAM_SIZE; ++i)
+        {
+            SPRRAM[i] = i % 4 == 0 ? next() % 240 : next();
+        }
+        for (int i = 0; i < 32; ++i)
+        {
+            PalTable[i] = next();
+        }
+        PPU_R0 = next();
+        PPU_R1 = next();
+        PPU_R2 = next();
+        PPU_Addr = next() & 0x7fff;
+        PPU_Scanline = next() % 240;
+        PPU_SP_Height = PPU_R0 & R0_SP_SIZE ? 16 : 8;
+        PPU_Scr_H_Byte = PPU_Addr & 31;
+        PPU_Scr_H_Bit = next() % 8;
+        PPU_NameTableBank = NAME_TABLE0 + ((PPU_Addr >> 10) & 3);
+        PPU_UpDown_Clip = next() & 1;
+    }
+
+    // What the CPU may change before the captured line is rendered
+    void scribble(WORD *lineBuffer)
+    {
+        randomBanks();
+        for (int i = 0; i < SPRRAM_SIZE; ++i)
+        {
+            SPRRAM[i] = next();
+        }
+        for (int i = 0; i < 32; ++i)
+        {
+            PalTable[i] = next();
+        }
+        PPU_R0 = next();
+        PPU_R1 = next();
+        PPU_Addr = next();
+        PPU_Scanline = next() % 240;
+        PPU_Scr_H_Byte = next() % 32;
+        PPU_Scr_H_Bit = next() % 8;
+        PPU_UpDown_Clip ^= 1;
+        InfoNES_SetLineBuffer(lineBuffer, NES_DISP_WIDTH);
+    }
+}
+
+int main()
+{
+    for (auto &b : memory_)
+    {
+        b = next();
+    }
+    MapperRenderScreen = Map0_RenderScreen;
+    MapperPPU = Map0_PPU;
+
+    static WORD sync[NES_DISP_WIDTH];
+    static WORD deferred[NES_DISP_WIDTH];
+    static WORD live[NES_DISP_WIDTH];
+    static CapturedLine line;
+    int pixelMismatches = 0;
+    int flagMismatches = 0;
+    int liveWrites = 0;
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        randomState();
+        BYTE r2 = PPU_R2;
+
+        memset(sync, 0, sizeof(sync));
+        InfoNES_SetLineBuffer(sync, NES_DISP_WIDTH);
+        InfoNES_DrawLine();
+        BYTE syncR2 = PPU_R2;
+
+        PPU_R2 = r2;
+        memset(deferred, 0, sizeof(deferred));
+        InfoNES_SetLineBuffer(deferred, NES_DISP_WIDTH);
+        InfoNES_CaptureLine(line);
+        flagMismatches += PPU_R2 != syncR2;
+
+        memset(live, 0, sizeof(live));
+        scribble(live);
+        std::thread core1([] { InfoNES_DrawLine(line); });
+        core1.join();
+
+        pixelMismatches += memcmp(sync, deferred, sizeof(sync)) != 0;
+        for (WORD p : live)
+        {
+            liveWrites += p != 0;
+        }
+    }
+
+    bool ok = !pixelMismatches && !flagMismatches && !liveWrites;
+    printf("%d lines: %d differ, %d sprite overflow flags differ, %d pixels went to the live buffer  %s\n",
+           ROUNDS, pixelMismatches, flagMismatches, liveWrites, ok ? "ok" : "FAILED");
+    return !ok;
+}
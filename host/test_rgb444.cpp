@@ -0,0 +1,51 @@
+// rgb444_pack() against bytes worked out by hand from the layout in rgb444.h:
+// byte 0: R1 G1, byte 1: B1 R2, byte 2: G2 B2.
+
+#include <stdio.h>
+#include <string.h>
+#include "rgb444.h"
+
+namespace
+{
+    int failed_;
+
+    void check(const char *name, const uint16_t *src, size_t pixels,
+               const uint8_t *expected, size_t size)
+    {
+        uint8_t dst[16];
+        memset(dst, 0xee, sizeof(dst));
+        size_t n = rgb444_pack(src, dst, pixels);
+        bool ok = n == size && memcmp(dst, expected, size) == 0 && dst[size] == 0xee;
+        printf("%-28s %s\n", name, ok ? "ok" : "FAILED");
+        if (!ok)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                printf(" %02x", dst[i]);
+            }
+            printf("\n");
+            ++failed_;
+        }
+    }
+}
+
+int main()
+{
+    const uint16_t pair[] = {0x123, 0x456};
+    const uint8_t pairBytes[] = {0x12, 0x34, 0x56};
+    check("one pair", pair, 2, pairBytes, sizeof(pairBytes));
+
+    const uint16_t four[] = {0xf00, 0x0f0, 0x00f, 0xfff};
+    const uint8_t fourBytes[] = {0xf0, 0x00, 0xf0, 0x00, 0xff, 0xff};
+    check("primaries and white", four, 4, fourBytes, sizeof(fourBytes));
+
+    const uint16_t odd[] = {0xabc, 0xdef, 0x789};
+    const uint8_t oddBytes[] = {0xab, 0xcd, 0xef, 0x78, 0x90, 0x00};
+    check("odd pixel padded black", odd, 3, oddBytes, sizeof(oddBytes));
+
+    const uint16_t high[] = {0xf123, 0x8456};
+    check("bits above 12 ignored", high, 2, pairBytes, sizeof(pairBytes));
+
+    check("no pixels", pair, 0, pairBytes, 0);
+    return failed_;
+}
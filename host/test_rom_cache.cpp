@@ -0,0 +1,135 @@
+// ROM residency ( rom_cache.h ): the generated cartridge ( host_system.h )
+// emulates bit for bit the same whether its banks are read from flash, from
+// PRG slots or from a whole RAM copy, and the XIP cache model ( xip_stats.h )
+// shows the flash reads each tier takes away.
+//
+// Built twice. Without ROM_CACHE it writes the reference run to
+// rom_cache_reference.txt, with it every tier is checked against that file.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "host_system.h"
+#include "xip_stats.h"
+#include "rom_cache.h"
+
+namespace
+{
+    constexpr int FRAMES = 300;
+    constexpr unsigned SEED = 1;
+    const char *const REFERENCE = "rom_cache_reference.txt";
+
+    const char *const PHASE_NAMES[XIP_PHASE_COUNT] = {"other", "cpu", "apu", "bg", "sprite"};
+
+    struct Result
+    {
+        unsigned long long hash;
+        uint32_t accesses[XIP_PHASE_COUNT]; // This run only
+        uint32_t hits[XIP_PHASE_COUNT];
+    };
+
+    Result run(const char *name)
+    {
+        XipStats before;
+        xip_stats_get(before);
+        HostRun hostRun = host_run(FRAMES, SEED);
+        XipStats after;
+        xip_stats_get(after);
+
+        Result r;
+        r.hash = hostRun.hash;
+        for (int i = 0; i < XIP_PHASE_COUNT; ++i)
+        {
+            r.accesses[i] = after.phase[i].accesses - before.phase[i].accesses;
+            r.hits[i] = after.phase[i].hits - before.phase[i].hits;
+            printf("  %-6s %9u accesses %9u misses\n", PHASE_NAMES[i], r.accesses[i], r.accesses[i] - r.hits[i]);
+        }
+        printf("%s: hash %016llx\n", name, r.hash);
+        return r;
+    }
+
+    uint32_t total(const uint32_t (&counts)[XIP_PHASE_COUNT])
+    {
+        uint32_t sum = 0;
+        for (uint32_t n : counts)
+        {
+            sum += n;
+        }
+        return sum;
+    }
+}
+
+#if !defined(ROM_CACHE)
+int main()
+{
+    Result r = run("flash only");
+    FILE *f = fopen(REFERENCE, "w");
+    if (!f)
+    {
+        printf("FAILED: cannot write %s\n", REFERENCE);
+        return 1;
+    }
+    fprintf(f, "%016llx\n", r.hash);
+    for (int i = 0; i < XIP_PHASE_COUNT; ++i)
+    {
+        fprintf(f, "%u %u\n", r.accesses[i], r.hits[i]);
+    }
+    fclose(f);
+    return 0;
+}
+#else
+namespace
+{
+    Result runTier(const char *name, const char *heap)
+    {
+        setenv("ROM_CACHE_HEAP", heap, 1);
+        Result r = run(name);
+        RomCacheStats stats;
+        rom_cache_get_stats(stats);
+        printf("  %u bank hits, %u bank copies\n", stats.hits, stats.misses);
+        return r;
+    }
+}
+
+int main()
+{
+    Result reference;
+    FILE *f = fopen(REFERENCE, "r");
+    bool read = f && fscanf(f, "%llx", &reference.hash) == 1;
+    for (int i = 0; read && i < XIP_PHASE_COUNT; ++i)
+    {
+        read = fscanf(f, "%u %u", &reference.accesses[i], &reference.hits[i]) == 2;
+    }
+    if (f)
+    {
+        fclose(f);
+    }
+    if (!read)
+    {
+        printf("FAILED: no reference in %s, run test_rom_cache_reference first\n", REFERENCE);
+        return 1;
+    }
+
+    // The cartridge has 32K PRG and 8K CHR, ROM_CACHE_HEAP_RESERVE is kept back
+    Result flash = runTier("no heap, flash", "0");
+    Result prg = runTier("PRG slots, CHR in flash", "53248");
+    Result whole = runTier("whole ROM in RAM", "524288");
+
+    int failed = 0;
+    auto check = [&](bool ok, const char *what) {
+        if (!ok)
+        {
+            printf("FAILED: %s\n", what);
+            ++failed;
+        }
+    };
+    check(flash.hash == reference.hash, "reading flash with ROM_CACHE matches the build without it");
+    check(prg.hash == reference.hash, "the PRG slots match the build without ROM_CACHE");
+    check(whole.hash == reference.hash, "the RAM copy matches the build without ROM_CACHE");
+    check(total(flash.accesses) == total(reference.accesses), "without heap every read still goes to flash");
+    check(prg.accesses[XIP_PHASE_CPU] * 100 < reference.accesses[XIP_PHASE_CPU],
+          "the PRG slots take nearly all opcode reads off flash");
+    check(prg.accesses[XIP_PHASE_BG] == reference.accesses[XIP_PHASE_BG], "CHR left in flash is still read there");
+    check(total(whole.accesses) == 0, "the RAM copy leaves nothing to read from flash");
+    return failed;
+}
+#endif
@@ -0,0 +1,111 @@
+// Scan-out on the host ( scanout.h, panel_sink.h ): core 0 queues frames
+// of lines as fast as it gets pool buffers, core 1 is a thread, and the
+// panel sink's DMA is modelled at the SPI clock. Every line the
+// downsampling keeps must reach the wire unchanged, big endian RGB565 or,
+// built with SPI_SCREEN_RGB444, packed by rgb444_pack(), although core 0
+// refills each pool buffer as soon as core 1 returns it. The transfer
+// timings are printed: with core 0 never waiting on anything else, the
+// link should be busy nearly all the time ( the threads share the host's
+// cores, so that is reported, not checked ).
+
+#include <stdio.h>
+#include <algorithm>
+#include "scanout.h"
+#include "panel_sink.h"
+#include "InfoNES.h"
+#include "rgb444.h"
+
+namespace
+{
+    constexpr int FRAMES = 4;
+
+    uint16_t pixel(int frame, int line, int x)
+    {
+        return static_cast<uint16_t>(frame * 0x1111 + line * 0x0101 + x * 0x0203);
+    }
+}
+
+int main()
+{
+    scanout_start();
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+        for (int line = 0; line < NES_DISP_HEIGHT; ++line)
+        {
+            auto b = scanout_acquire_line();
+            for (int x = 0; x < NES_DISP_WIDTH; ++x)
+            {
+                (*b)[x] = pixel(frame, line, x);
+            }
+            scanout_submit_line(line, b);
+        }
+    }
+    scanout_stop();
+
+    int failed = 0;
+    auto check = [&](bool ok, const char *what) {
+        if (!ok)
+        {
+            printf("FAILED: %s\n", what);
+            ++failed;
+        }
+    };
+
+    // Output row r shows source row r * factor / 100, the same for the columns
+    int rows = std::min(MIPI_DISPLAY_HEIGHT,
+                        (NES_DISP_HEIGHT * 100 + PANEL_DOWNSAMPLING_FACTOR - 1) / PANEL_DOWNSAMPLING_FACTOR);
+    int columns = std::min(MIPI_DISPLAY_WIDTH,
+                           (NES_DISP_WIDTH * 100 + PANEL_DOWNSAMPLING_FACTOR - 1) / PANEL_DOWNSAMPLING_FACTOR);
+    auto &transfers = panel_sink_get_transfers();
+    check(static_cast<int>(transfers.size()) == FRAMES * rows, "every kept row is sent once per frame");
+
+    bool rowsOk = true;
+    bool dataOk = true;
+    bool ordered = true;
+    uint64_t wireUs = 0;
+    uint64_t waitUs = 0;
+    for (size_t i = 0; i < transfers.size(); ++i)
+    {
+        auto &t = transfers[i];
+        int frame = i / rows;
+        int row = i % rows;
+        int line = row * PANEL_DOWNSAMPLING_FACTOR / 100;
+        uint8_t expected[MIPI_DISPLAY_WIDTH * 2];
+        int size = 0;
+#if defined(SPI_SCREEN_RGB444)
+        uint16_t kept[MIPI_DISPLAY_WIDTH];
+        for (int x = 0; x < columns; ++x)
+        {
+            kept[x] = pixel(frame, line, x * PANEL_DOWNSAMPLING_FACTOR / 100);
+        }
+        size = rgb444_pack(kept, expected, columns);
+#else
+        for (int x = 0; x < columns; ++x)
+        {
+            uint16_t c = pixel(frame, line, x * PANEL_DOWNSAMPLING_FACTOR / 100);
+            expected[size++] = c >> 8;
+            expected[size++] = c;
+        }
+#endif
+        rowsOk &= t.row == row;
+        dataOk &= t.data == std::vector<uint8_t>(expected, expected + size);
+        ordered &= i == 0 || static_cast<int32_t>(t.startUs - transfers[i - 1].endUs) >= 0;
+        wireUs += t.endUs - t.startUs;
+        waitUs += t.waitUs;
+    }
+    check(rowsOk, "rows go out in order");
+    check(dataOk, "pixels are downsampled and sent in the panel's format");
+    check(ordered, "a transfer starts after the one before has ended");
+
+    uint32_t spanUs = transfers.back().endUs - transfers.front().startUs;
+    double busy = spanUs ? 100.0 * wireUs / spanUs : 0;
+    ScanoutStats s;
+    scanout_get_stats(s);
+    printf("%zu transfers of %zu bytes, %.1f us each on the wire\n", transfers.size(), transfers[0].data.size(),
+           static_cast<double>(wireUs) / transfers.size());
+    printf("link busy %.1f%% of %u us, core 1 waited %.1f us per line for the DMA\n", busy, spanUs,
+           static_cast<double>(waitUs) / transfers.size());
+    printf("core 0 stalled %u times, %u us\n", s.stalls, s.stallUs);
+    check(s.linesSent == FRAMES * NES_DISP_HEIGHT, "every queued line reaches the sink");
+    return failed;
+}
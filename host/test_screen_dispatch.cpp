@@ -0,0 +1,122 @@
+// screen_dispatch.h with the host backend: built with
+// SCREEN_BACKEND_CLASS=host::Screen the per-line and per-sample calls of
+// main.cpp and audio.cpp must bind to host::Screen at compile time, built
+// without it they go through the ScreenOutput vtable. A class derived from
+// the stand-in counts the calls that reach it virtually, lines and audio
+// must arrive either way.
+
+#include <stdio.h>
+#include "FrensHelpers.h"
+#include "screen_dispatch.h"
+#include "audio.h"
+#include "InfoNES_System.h"
+
+namespace
+{
+    int failed_;
+
+    void check(bool ok, const char *what)
+    {
+        printf("%-52s %s\n", what, ok ? "ok" : "FAILED");
+        failed_ += !ok;
+    }
+
+    // Only a virtual call finds these overrides
+    class Spy : public host::Screen
+    {
+    public:
+        int virtualCalls = 0;
+
+        LineBuffer *getLineBuffer() override
+        {
+            ++virtualCalls;
+            return Screen::getLineBuffer();
+        }
+
+        void setLineBuffer(int line, LineBuffer *p) override
+        {
+            ++virtualCalls;
+            Screen::setLineBuffer(line, p);
+        }
+
+        uint32_t getFrameCounter() const override
+        {
+            ++const_cast<Spy *>(this)->virtualCalls;
+            return Screen::getFrameCounter();
+        }
+
+        util::RingBuffer<AudioSample> &getAudioRingBuffer() override
+        {
+            ++virtualCalls;
+            return Screen::getAudioRingBuffer();
+        }
+    };
+
+    constexpr int SAMPLES = 735; // One frame at 44.1 kHz
+}
+
+int main()
+{
+#if defined(SCREEN_BACKEND_CLASS)
+    printf("static dispatch to %s\n", "host::Screen");
+    check(screen::isStatic, "SCREEN_BACKEND_CLASS selects static dispatch");
+#else
+    printf("virtual dispatch\n");
+    check(!screen::isStatic, "no SCREEN_BACKEND_CLASS, virtual dispatch");
+#endif
+
+    Spy spy;
+    dvi_ = &spy;
+    spy.allocateAudioBuffer(1024);
+
+    // A frame of lines, like InfoNES_PreDrawLine() / InfoNES_PostDrawLine()
+    for (int line = 0; line < host::Screen::HEIGHT; ++line)
+    {
+        auto b = screen::getLineBuffer();
+        for (int x = 0; x < host::Screen::WIDTH; ++x)
+        {
+            (*b)[x] = line * 0x0101 + x;
+        }
+        screen::setLineBuffer(line, b);
+    }
+    bool linesOk = spy.lines().size() == host::Screen::HEIGHT;
+    for (int i = 0; linesOk && i < host::Screen::HEIGHT; ++i)
+    {
+        auto &l = spy.lines()[i];
+        linesOk = l.line == i && l.pixels[0] == i * 0x0101 && l.pixels[319] == i * 0x0101 + 319;
+    }
+    check(linesOk, "every line reaches the backend");
+    check(screen::getFrameCounter() == 1, "the frame counter advances on the last line");
+
+    // A frame of audio through audio.cpp
+    BYTE w1[SAMPLES], w2[SAMPLES], w3[SAMPLES], w4[SAMPLES], w5[SAMPLES];
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        w1[i] = i % 16;
+        w2[i] = (i / 3) % 16;
+        w3[i] = (i / 5) % 16;
+        w4[i] = (i / 7) % 16;
+        w5[i] = i % 128;
+    }
+    InfoNES_SoundInit();
+    InfoNES_SoundOpen(SAMPLES, 44100);
+    InfoNES_SoundOutput(SAMPLES, w1, w2, w3, w4, w5);
+    auto &ring = spy.Screen::getAudioRingBuffer();
+    bool audioOk = ring.getFullReadableSize() == SAMPLES;
+    for (int i = 0; audioOk && i < SAMPLES; ++i)
+    {
+        auto s = ring.getReadPointer()[0];
+        DWORD expected = SoundPulseMix[w1[i] * 16 + w2[i]] + SoundTndMix[3 * w3[i] + 2 * w4[i] + w5[i]];
+        audioOk = static_cast<uint16_t>(s.l) == (expected & 0xffff) && static_cast<uint16_t>(s.r) == (expected >> 16);
+        ring.advanceReadPointer(1);
+    }
+    check(audioOk, "every sample reaches the backend's ring");
+
+    printf("%d calls went through the vtable\n", spy.virtualCalls);
+#if defined(SCREEN_BACKEND_CLASS)
+    check(spy.virtualCalls == 0, "no per-line or per-sample call is virtual");
+#else
+    check(spy.virtualCalls > 2 * host::Screen::HEIGHT, "every call is virtual");
+#endif
+    return failed_;
+}
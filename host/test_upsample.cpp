@@ -0,0 +1,135 @@
+// Images of the linear upsampling in audio.cpp, which stretches 22050 and
+// 11025 Hz APU output to the 44.1 kHz ring.
+//
+// A sine at the APU rate goes through InfoNES_SoundLockBuffer() /
+// InfoNES_SoundUnlockBuffer() into the host screen's ring. The power of
+// the 44.1 kHz spectrum ( Hann window, 16384 points ) around the images
+// of the tone, m * rate +- f0, is reported relative to the tone. Stepping
+// linearly over u = 44100 / rate output samples is a triangle kernel, its
+// gain at f is ( sin(pi f / rate) / ( u sin(pi f / 44100) ) )^2. The
+// measurement must agree with that.
+//
+// The BLEP steps ( test_apu_alias ) are band-limited at the APU rate only,
+// these images come on top of them at every rate below 44.1 kHz.
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "FrensHelpers.h"
+#include "audio.h"
+#include "InfoNES_System.h"
+#include "spectrum.h"
+
+namespace
+{
+    constexpr int OUTPUT_RATE = 44100;
+    constexpr int N = 16384;       // Points of the spectrum
+    constexpr int SETTLE = 1000;   // Output samples dropped first
+    constexpr int CHUNK = 256;     // APU samples per lock
+    constexpr double AMPLITUDE = 8000;
+    constexpr double MAX_MODEL_ERROR_DB = 0.5;
+
+    int failed_;
+
+    // Power gain of the linear stretch from rate at f
+    double gain(double f, int rate)
+    {
+        int u = OUTPUT_RATE / rate;
+        return pow(sin(M_PI * f / rate) / (u * sin(M_PI * f / OUTPUT_RATE)), 4);
+    }
+
+    // Image power relative to the tone, dB
+    double predicted(double f0, int rate)
+    {
+        double tone = gain(f0, rate);
+        double images = 0;
+        for (int m = 1; m * rate - f0 < OUTPUT_RATE / 2; ++m)
+        {
+            for (double f : {m * rate - f0, m * rate + f0})
+            {
+                if (f < OUTPUT_RATE / 2)
+                {
+                    images += gain(f, rate);
+                }
+            }
+        }
+        return 10 * log10(images / tone);
+    }
+
+    double measured(host::Screen &screen, double f0, int rate)
+    {
+        InfoNES_SoundOpen(rate / 60, rate);
+        auto &ring = screen.getAudioRingBuffer();
+        ring.advanceReadPointer(ring.getFullReadableSize());
+
+        std::vector<double> out;
+        double phase = 0;
+        while (static_cast<int>(out.size()) < SETTLE + N)
+        {
+            int locked;
+            DWORD *p = InfoNES_SoundLockBuffer(CHUNK, &locked);
+            for (int i = 0; i < locked; ++i)
+            {
+                auto s = static_cast<uint16_t>(lround(AMPLITUDE * sin(phase)));
+                p[i] = s | static_cast<DWORD>(s) << 16;
+                phase += 2 * M_PI * f0 / rate;
+            }
+            InfoNES_SoundUnlockBuffer(locked);
+            while (ring.getFullReadableSize())
+            {
+                out.push_back(ring.getReadPointer()[0].l);
+                ring.advanceReadPointer(1);
+            }
+        }
+
+        auto power = spectrum::power(out.begin() + SETTLE, N);
+        // The Hann window spreads a line over a few bins
+        auto near = [](double f, int k) { return fabs(static_cast<double>(k) * OUTPUT_RATE / N - f) < 3.0 * OUTPUT_RATE / N; };
+        double tone = 0;
+        double images = 0;
+        for (int k = 1; k <= N / 2; ++k)
+        {
+            if (near(f0, k))
+            {
+                tone += power[k];
+            }
+            for (int m = 1; m * rate - f0 < OUTPUT_RATE / 2; ++m)
+            {
+                if (near(m * rate - f0, k) || near(m * rate + f0, k))
+                {
+                    images += power[k];
+                }
+            }
+        }
+        return 10 * log10(images / tone);
+    }
+}
+
+int main()
+{
+    host::Screen screen;
+    dvi_ = &screen;
+    screen.allocateAudioBuffer(4096);
+    InfoNES_SoundInit();
+
+    struct Case
+    {
+        int rate;
+        double f0;
+    };
+    const Case cases[] = {
+        {22050, 440}, {22050, 2000}, {22050, 5000}, {22050, 9000},
+        {11025, 440}, {11025, 2000}, {11025, 4500},
+    };
+
+    printf("APU rate     tone   images measured  kernel model\n");
+    for (auto &c : cases)
+    {
+        double m = measured(screen, c.f0, c.rate);
+        double p = predicted(c.f0, c.rate);
+        bool ok = fabs(m - p) <= MAX_MODEL_ERROR_DB;
+        printf("%5d Hz %5.0f Hz   %8.1f dB   %8.1f dB  %s\n", c.rate, c.f0, m, p, ok ? "ok" : "FAILED");
+        failed_ += !ok;
+    }
+    return failed_;
+}
@@ -0,0 +1,84 @@
+// XIP cache model ( xip_stats.h ): the hit rates the host reports for the
+// generated cartridge ( host_system.h ) with the RP2040's 16K cache and
+// with a 4K one, which its 12K or so of code, data and patterns overflow.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "host_system.h"
+#include "xip_stats.h"
+
+namespace
+{
+    constexpr int FRAMES = 300;
+    constexpr unsigned SEED = 1;
+
+    const char *const PHASE_NAMES[XIP_PHASE_COUNT] = {"other", "cpu", "apu", "bg", "sprite"};
+
+    struct Result
+    {
+        HostRun run;
+        XipStats stats; // This run only
+    };
+
+    Result run(const char *size)
+    {
+        XipStats before;
+        xip_stats_get(before);
+        setenv("XIP_MODEL_SIZE", size, 1);
+
+        Result r;
+        r.run = host_run(FRAMES, SEED);
+        xip_stats_get(r.stats);
+        r.stats.frames -= before.frames;
+        uint32_t hits = 0;
+        uint32_t accesses = 0;
+        for (int i = 0; i < XIP_PHASE_COUNT; ++i)
+        {
+            auto &p = r.stats.phase[i];
+            p.hits -= before.phase[i].hits;
+            p.accesses -= before.phase[i].accesses;
+            hits += p.hits;
+            accesses += p.accesses;
+            printf("  %-6s %9u accesses %5.1f%% hits\n", PHASE_NAMES[i], p.accesses,
+                   p.accesses ? 100.0 * p.hits / p.accesses : 100.0);
+        }
+        printf("%s bytes: %u frames, %u accesses, %.1f%% hits, hash %016llx\n", size,
+               r.stats.frames, accesses, accesses ? 100.0 * hits / accesses : 100.0,
+               static_cast<unsigned long long>(r.run.hash));
+        return r;
+    }
+
+    double hitPct(const XipStats &stats)
+    {
+        uint64_t hits = 0;
+        uint64_t accesses = 0;
+        for (auto &p : stats.phase)
+        {
+            hits += p.hits;
+            accesses += p.accesses;
+        }
+        return accesses ? 100.0 * hits / accesses : 100.0;
+    }
+}
+
+int main()
+{
+    Result big = run("16384");
+    Result small = run("4096");
+
+    int failed = 0;
+    auto check = [&](bool ok, const char *what) {
+        if (!ok)
+        {
+            printf("FAILED: %s\n", what);
+            ++failed;
+        }
+    };
+    check(big.run.hash == small.run.hash, "the model does not change the emulation");
+    check(big.stats.frames == FRAMES, "every frame is closed");
+    check(big.stats.phase[XIP_PHASE_CPU].accesses > 0, "opcode reads are charged to the CPU");
+    check(big.stats.phase[XIP_PHASE_BG].accesses > 0, "pattern fetches are charged to the background");
+    check(hitPct(big.stats) > 98.0, "the working set fits a 16K cache");
+    check(hitPct(small.stats) < hitPct(big.stats) - 5.0, "a 4K cache misses more");
+    return failed;
+}
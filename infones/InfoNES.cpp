@@ -60,13 +60,26 @@ enum
   MARKER_SPRITE = makeTag(31, 0, 0),
 };
 
+// End of a work phase, for the work meter and the XIP cache counters
+#if defined(XIP_STATS)
+#define MARK_WORK(tag, phase) (util::WorkMeterMark(tag), InfoNES_XipPhase(phase))
+#else
+#define MARK_WORK(tag, phase) util::WorkMeterMark(tag)
+#endif
+
+// Mappers that switch banks while rendering (MMC2, MMC5, ...) have to see every line
+static inline bool hasRenderHooks()
+{
+  return MapperRenderScreen != Map0_RenderScreen || MapperPPU != Map0_PPU;
+}
+
 /*-------------------------------------------------------------------*/
 /*  NES resources                                                    */
 /*-------------------------------------------------------------------*/
 
 #pragma region buffers
 /* RAM */
-BYTE *RAM;
+BYTE RAM[RAM_SIZE];
 // Share this memory with other components (menu.cpp, romselect.cpp, main.cpp)
 // void *InfoNes_GetRAM(size_t *size)
 // {
@@ -75,20 +88,10 @@ BYTE *RAM;
 //   return SRAM;
 // }
 /* SRAM */
-BYTE *SRAM;
+BYTE SRAM[SRAM_SIZE];
 
-/* Character Buffer */
-BYTE *ChrBuf;
-
-// Share this memory with other components (menu.cpp, romselect.cpp, main.cpp)
-// void *InfoNes_GetChrBuf(size_t *size)
-// {
-//   printf("Acquired ChrBuf Buffer from emulator: %d bytes\n", CHRBUF_SIZE);
-//   *size = CHRBUF_SIZE;
-//   return ChrBuf;
-// }
 /* PPU RAM */
-BYTE *PPURAM;
+BYTE PPURAM[PPURAM_SIZE];
 // Share this memory with other components (menu.cpp, romselect.cpp, main.cpp)
 // void *InfoNes_GetPPURAM(size_t *size)
 // {
@@ -97,9 +100,9 @@ BYTE *PPURAM;
 //   return PPURAM;
 // }
 /* PPU BANK ( 1Kb * 16 ) */
-BYTE *PPUBANK[16];
+__core0_state("ppubank") BYTE *PPUBANK[16];
 /* Sprite RAM */
-BYTE *SPRRAM;
+BYTE SPRRAM[SPRRAM_SIZE];
 // Share this memory with other components (menu.cpp, romselect.cpp, main.cpp)
 // void *InfoNes_GetSPRRAM(size_t *size)
 // {
@@ -119,8 +122,10 @@ BYTE *ROM;
 /* SRAM BANK ( 8Kb ) */
 BYTE *SRAMBANK;
 
-/* ROM BANK ( 8Kb * 4 ) */
-BYTE *ROMBANK[4];
+/* Hot emulator state ( see InfoNES.h ) */
+__core0_state("infones_state") struct InfoNES_State_tag InfoNES_State;
+
+/* ROM BANK ( 8Kb * 4 ): InfoNES_State.ROMBANK */
 // BYTE *ROMBANK0;
 // BYTE *ROMBANK1;
 // BYTE *ROMBANK2;
@@ -134,12 +139,7 @@ BYTE *ROMBANK[4];
 BYTE *VROM;
 
 // BYTE *SPRRAM;
-/* PPU Register */
-BYTE PPU_R0;
-BYTE PPU_R1;
-BYTE PPU_R2;
-BYTE PPU_R3;
-BYTE PPU_R7;
+/* PPU Register: InfoNES_State.PPU_R0 ... PPU_R7 */
 
 /* Vertical scroll value */
 // BYTE PPU_Scr_V;
@@ -152,51 +152,17 @@ BYTE PPU_R7;
 /* Horizontal scroll value */
 // BYTE PPU_Scr_H;
 // BYTE PPU_Scr_H_Next;
-BYTE PPU_Scr_H_Byte;
 // BYTE PPU_Scr_H_Byte_Next;
-BYTE PPU_Scr_H_Bit;
 // BYTE PPU_Scr_H_Bit_Next;
 
-/* PPU Address */
-WORD PPU_Addr;
-
-/* PPU Address */
-WORD PPU_Temp;
-
-/* The increase value of the PPU Address */
-WORD PPU_Increment;
-
-/* Current Scanline */
-WORD PPU_Scanline;
-
-/* Name Table Bank */
-BYTE PPU_NameTableBank;
-
-/* BG Base Address */
-BYTE *PPU_BG_Base;
-
-/* Sprite Base Address */
-BYTE *PPU_SP_Base;
-
-/* Sprite Height */
-WORD PPU_SP_Height;
+/* PPU_Scr_H_Byte, PPU_Scr_H_Bit, PPU_Addr, PPU_Temp, PPU_Increment,
+   PPU_Scanline, PPU_NameTableBank, PPU_BG_Base, PPU_SP_Base, PPU_SP_Height,
+   byVramWriteEnable, PPU_Latch_Flag, PPU_UpDown_Clip, FrameIRQ_Enable and
+   FrameStep live in InfoNES_State */
 
 /* Sprite #0 Scanline Hit Position */
 int SpriteJustHit;
 
-/* VRAM Write Enable ( 0: Disable, 1: Enable ) */
-BYTE byVramWriteEnable;
-
-/* PPU Address and Scroll Latch Flag*/
-BYTE PPU_Latch_Flag;
-
-/* Up and Down Clipping Flag ( 0: non-clip, 1: clip ) */
-BYTE PPU_UpDown_Clip;
-
-/* Frame IRQ ( 0: Disabled, 1: Enabled )*/
-BYTE FrameIRQ_Enable;
-WORD FrameStep;
-
 /*-------------------------------------------------------------------*/
 /*  Display and Others resouces                                      */
 /*-------------------------------------------------------------------*/
@@ -224,7 +190,20 @@ void __not_in_flash_func(InfoNES_SetLineBuffer)(WORD *p, WORD size)
 BYTE ChrBufUpdate;
 
 /* Palette Table */
-WORD PalTable[32];
+__core0_state("paltable") WORD PalTable[32];
+
+/* Generation counters of PalTable and the pattern tables ( bumped on write ) */
+DWORD PalTableGen;
+DWORD PatternGen;
+
+#if defined(DIRTY_LINES)
+/* Input signature of each scanline in the previous frame ( 0: invalid ) */
+DWORD PPU_LineSig[NES_DISP_HEIGHT];
+
+/* Lines skipped / redrawn since the counters were last cleared */
+DWORD DirtyLineHits;
+DWORD DirtyLineMisses;
+#endif
 
 /* Table for Mirroring */
 BYTE PPU_MirrorTable[][4] =
@@ -246,12 +225,7 @@ BYTE APU_Reg[0x18];
 /* APU Mute ( 0:OFF, 1:ON ) */
 int APU_Mute = 0;
 
-/* Pad data */
-DWORD PAD1_Latch;
-DWORD PAD2_Latch;
-DWORD PAD_System;
-DWORD PAD1_Bit;
-DWORD PAD2_Bit;
+/* Pad data: InfoNES_State.PAD1_Latch ... PAD_System */
 
 /*-------------------------------------------------------------------*/
 /*  Mapper Function                                                  */
@@ -307,15 +281,10 @@ void InfoNES_Init()
    *  Initialize InfoNES
    *
    *  Remarks
-   *    Initialize memory, K6502 and Scanline Table.
+   *    Initialize K6502 and Scanline Table. The memories are static,
+   *    their layout is fixed at link time.
    */
 
-  RAM = (BYTE *)malloc(RAM_SIZE);
-  SRAM = (BYTE *)malloc(SRAM_SIZE);
-  PPURAM = (BYTE *)malloc(PPURAM_SIZE);
-  SPRRAM = (BYTE *)malloc(SPRRAM_SIZE);
-  ChrBuf = (BYTE *)malloc(CHRBUF_SIZE);
-  
   int nIdx;
 
   // Initialize 6502
@@ -356,11 +325,6 @@ void InfoNES_Fin()
 
   // Release a memory for ROM
   InfoNES_ReleaseRom();
-  free(RAM);
-  free(SRAM);
-  free(PPURAM);
-  free(SPRRAM);
-  free(ChrBuf);
 }
 
 /*===================================================================*/
@@ -452,6 +416,9 @@ int InfoNES_Reset()
   // Clear RAM
   InfoNES_MemorySet(RAM, 0, RAM_SIZE);
 
+  // Clear the work RAM the previous cassette's mapper left behind
+  InfoNES_MemorySet(&MapperRam, 0, sizeof MapperRam);
+
   // Reset frame skip and frame count
   FrameSkip = 0;
   FrameCnt = 0;
@@ -467,6 +434,10 @@ int InfoNES_Reset()
 
   // Reset palette table
   InfoNES_MemorySet(PalTable, 0, sizeof PalTable);
+  ++PalTableGen;
+
+  // Nothing on screen comes from this cassette yet
+  InfoNES_InvalidateLines();
 
   // Reset APU register
   InfoNES_MemorySet(APU_Reg, 0, sizeof APU_Reg);
@@ -507,6 +478,9 @@ int InfoNES_Reset()
 
   // Set up a mapper initialization function
   MapperTable[nIdx].pMapperInit();
+#if defined(ROM_CACHE)
+  InfoNES_BankSync();
+#endif
 
   /*-------------------------------------------------------------------*/
   /*  Reset CPU                                                        */
@@ -566,8 +540,8 @@ void InfoNES_SetupPPU()
   // Reset information on PPU_R0
   PPU_Increment = 1;
   PPU_NameTableBank = NAME_TABLE0;
-  PPU_BG_Base = ChrBuf;
-  PPU_SP_Base = ChrBuf + 256 * 64;
+  PPU_BG_Base = 0;
+  PPU_SP_Base = 256 * 64;
   PPU_SP_Height = 8;
 
   // Reset PPU banks
@@ -662,7 +636,7 @@ void __not_in_flash_func(InfoNES_Cycle)()
   // Emulation loop
   for (;;)
   {
-    util::WorkMeterMark(MARKER_START);
+    MARK_WORK(MARKER_START, XIP_PHASE_OTHER);
 
     // Set a flag if a scanning line is a hit in the sprite #0
     if (SpriteJustHit == PPU_Scanline &&
@@ -700,10 +674,14 @@ void __not_in_flash_func(InfoNES_Cycle)()
       APU_Reg[0x15] |= 0x40;
     }
 
-    util::WorkMeterMark(MARKER_CPU);
+    MARK_WORK(MARKER_CPU, XIP_PHASE_CPU);
 
     // A mapper function in H-Sync
     MapperHSync();
+#if defined(ROM_CACHE)
+    // Banks switched in during this line
+    InfoNES_BankSync();
+#endif
 
     // A function in H-Sync
     if (InfoNES_HSync() == -1)
@@ -730,7 +708,7 @@ int __not_in_flash_func(InfoNES_HSync)()
    */
 
   InfoNES_pAPUHsync(!APU_Mute);
-  util::WorkMeterMark(MARKER_SOUND);
+  MARK_WORK(MARKER_SOUND, XIP_PHASE_APU);
 
   // int tmpv = (PPU_Addr >> 12) + ((PPU_Addr >> 5) << 3);
   // tmpv -= PPU_Scanline >= 240 ? 0 : PPU_Scanline;
@@ -742,16 +720,32 @@ int __not_in_flash_func(InfoNES_HSync)()
   /*-------------------------------------------------------------------*/
   /*  Render a scanline                                                */
   /*-------------------------------------------------------------------*/
-  if (FrameCnt == 0 &&
-      PPU_ScanTable[PPU_Scanline] == SCAN_ON_SCREEN)
+  if (PPU_ScanTable[PPU_Scanline] == SCAN_ON_SCREEN)
   {
-    if (PPU_Scanline >= 4 && PPU_Scanline < 240 - 4)
+    if (FrameCnt == 0 &&
+        PPU_Scanline >= 4 && PPU_Scanline < 240 - 4 &&
+        (InfoNES_IsLineVisible(PPU_Scanline) || hasRenderHooks()) &&
+        !InfoNES_IsLineUnchanged())
     {
       InfoNES_PreDrawLine(PPU_Scanline);
-      InfoNES_DrawLine();
+#if defined(PPU_CORE1)
+      // Mapper callbacks run in the middle of rendering, only lines without them are deferred
+      CapturedLine *deferred = nullptr;
+      if (!hasRenderHooks())
+        deferred = InfoNES_DeferDrawLine(PPU_Scanline);
+      if (deferred)
+        InfoNES_CaptureLine(*deferred);
+      else
+#endif
+        InfoNES_DrawLine();
       InfoNES_PostDrawLine(PPU_Scanline);
     }
-    // todo: 描画しないラインにもスプライトオーバーレジスタとかは反映する必要がある
+    else
+    {
+      // Lines that are not drawn still update the sprite overflow flag.
+      // Sprite #0 hit does not depend on rendering (see InfoNES_GetSprHitY).
+      InfoNES_EvalSpriteLine();
+    }
   }
 
   util::WorkMeterReset(); // 計測起点はここ
@@ -907,6 +901,27 @@ namespace
   }
 }
 
+namespace
+{
+  // Registers and scroll of the current scanline
+  inline void capturePPURegs(PpuLine &line)
+  {
+    line.WorkLine = WorkLine;
+    line.Scanline = PPU_Scanline;
+    line.Addr = PPU_Addr;
+    line.SPHeight = PPU_SP_Height;
+    line.R0 = PPU_R0;
+    line.R1 = PPU_R1;
+    line.ScrHByte = PPU_Scr_H_Byte;
+    line.ScrHBit = PPU_Scr_H_Bit;
+    line.NameTableBank = PPU_NameTableBank;
+    line.UpDownClip = PPU_UpDown_Clip;
+  }
+}
+
+// Returns the number of sprites on the line, -1 if sprites are hidden
+static int drawLine(const PpuLine &line);
+
 /*===================================================================*/
 /*                                                                   */
 /*              InfoNES_DrawLine() : Render a scanline               */
@@ -917,8 +932,115 @@ void __not_in_flash_func(InfoNES_DrawLine)()
   /*
    *  Render a scanline
    *
+   *  Remarks
+   *    Renders straight from the PPU state, nothing is copied. Only
+   *    the pointers and registers of a PpuLine go on the stack.
+   */
+
+  PpuLine line;
+  capturePPURegs(line);
+  line.Bank = PPUBANK;
+  line.Pal = PalTable;
+  line.Spr = SPRRAM;
+  line.SprCount = SPRRAM_SIZE / 4;
+
+  int nSprCnt = drawLine(line);
+  if (nSprCnt >= 0)
+  {
+    // Set a flag of maximum sprites on scanline
+    PPU_R2 = (PPU_R2 & ~R2_MAX_SP) | (nSprCnt >= 8 ? R2_MAX_SP : 0);
+  }
+}
+
+#if defined(PPU_CORE1)
+/*===================================================================*/
+/*                                                                   */
+/*      InfoNES_CaptureLine() : Capture a scanline to render later   */
+/*                                                                   */
+/*===================================================================*/
+void __not_in_flash_func(InfoNES_CaptureLine)(CapturedLine &line)
+{
+  /*
+   *  Capture the PPU state of a scanline to render it later
+   *
+   *  Remarks
+   *    The bank pointers, the palette and the sprites on this line are
+   *    copied, the CPU is free to change them as soon as this returns.
+   *    Pattern and name table memory is not copied, writes to it wait
+   *    for the captured lines first ( see InfoNES_WaitDrawLine ).
+   *    Sets the sprite overflow flag like InfoNES_DrawLine().
    */
 
+  capturePPURegs(line);
+  InfoNES_MemoryCopy(line.Banks, PPUBANK, sizeof line.Banks);
+  InfoNES_MemoryCopy(line.Palette, PalTable, sizeof line.Palette);
+  line.Bank = line.Banks;
+  line.Pal = line.Palette;
+  line.Spr = line.Sprites;
+  line.SprCount = 0;
+
+  if (!(PPU_R1 & R1_SHOW_SP))
+    return;
+
+  // Only the sprites on this line, in OAM order so the priorities hold
+  BYTE *pDst = line.Sprites;
+  for (BYTE *pSPRRAM = SPRRAM; pSPRRAM < SPRRAM + SPRRAM_SIZE; pSPRRAM += 4)
+  {
+    int nY = pSPRRAM[SPR_Y] + 1;
+    if (nY > PPU_Scanline || nY + PPU_SP_Height <= PPU_Scanline)
+      continue; // Next sprite
+
+    InfoNES_MemoryCopy(pDst, pSPRRAM, 4);
+    pDst += 4;
+  }
+  line.SprCount = (pDst - line.Sprites) >> 2;
+
+  // Set a flag of maximum sprites on scanline
+  PPU_R2 = (PPU_R2 & ~R2_MAX_SP) | (line.SprCount >= 8 ? R2_MAX_SP : 0);
+}
+
+void __not_in_flash_func(InfoNES_DrawLine)(const PpuLine &line)
+{
+  drawLine(line);
+}
+#endif
+
+// The renderer reads these from the PpuLine, not from InfoNES_State
+#pragma push_macro("PPU_Scanline")
+#pragma push_macro("PPU_Addr")
+#pragma push_macro("PPU_SP_Height")
+#pragma push_macro("PPU_R0")
+#pragma push_macro("PPU_R1")
+#pragma push_macro("PPU_Scr_H_Byte")
+#pragma push_macro("PPU_Scr_H_Bit")
+#pragma push_macro("PPU_NameTableBank")
+#pragma push_macro("PPU_UpDown_Clip")
+#undef PPU_Scanline
+#undef PPU_Addr
+#undef PPU_SP_Height
+#undef PPU_R0
+#undef PPU_R1
+#undef PPU_Scr_H_Byte
+#undef PPU_Scr_H_Bit
+#undef PPU_NameTableBank
+#undef PPU_UpDown_Clip
+static int __not_in_flash_func(drawLine)(const PpuLine &line)
+{
+  // The PPU state under the names the renderer below has always used
+  WORD *const WorkLine = line.WorkLine;
+  BYTE *const *const PPUBANK = line.Bank;
+  const WORD *const PalTable = line.Pal;
+  const BYTE *const SPRRAM = line.Spr;
+  const int PPU_Scanline = line.Scanline;
+  const WORD PPU_Addr = line.Addr;
+  const WORD PPU_SP_Height = line.SPHeight;
+  const BYTE PPU_R0 = line.R0;
+  const BYTE PPU_R1 = line.R1;
+  const BYTE PPU_Scr_H_Byte = line.ScrHByte;
+  const BYTE PPU_Scr_H_Bit = line.ScrHBit;
+  const BYTE PPU_NameTableBank = line.NameTableBank;
+  const BYTE PPU_UpDown_Clip = line.UpDownClip;
+
   int nX;
   int nY;
   int nY4;
@@ -928,8 +1050,8 @@ void __not_in_flash_func(InfoNES_DrawLine)()
   WORD *pPoint;
   int nNameTable;
   BYTE *pbyNameTable;
-  BYTE *pbyChrData;
-  BYTE *pSPRRAM;
+  int nChrOfs;
+  const BYTE *pSPRRAM;
   int nAttr;
   int nSprCnt;
   int nIdx;
@@ -995,7 +1117,7 @@ void __not_in_flash_func(InfoNES_DrawLine)()
     /*-------------------------------------------------------------------*/
 
     pbyNameTable = PPUBANK[nNameTable] + nY * 32 + nX;
-    pbyChrData = PPU_BG_Base + (*pbyNameTable << 6) + nYBit;
+    nChrOfs = PPU_BG_Base + (*pbyNameTable << 6) + nYBit;
     pAttrBase = PPUBANK[nNameTable] + 0x3c0 + (nY / 4) * 8;
 #if 0
     pPalTbl = &PalTable[(((pAttrBase[nX >> 2] >> ((nX & 2) + nY4)) & 3) << 2)];
@@ -1013,6 +1135,8 @@ void __not_in_flash_func(InfoNES_DrawLine)()
       const int bank = (ch >> 6) + bankOfsBG;
       const int addrOfs = ((ch & 63) << 4) + yOfsModBG;
       const auto data = PPUBANK[bank] + addrOfs;
+      XIP_READ(data);
+      XIP_READ(data + 8);
       const auto pl0 = data[0];
       const auto pl1 = data[8];
       const auto pat0 = (pl0 & 0x55) | ((pl1 << 1) & 0xaa);
@@ -1042,7 +1166,7 @@ void __not_in_flash_func(InfoNES_DrawLine)()
 #endif
 
     // Callback at PPU read/write
-    MapperPPU(PATTBL(pbyChrData));
+    MapperPPU(PATTBL(nChrOfs));
 
     ++nX;
     ++pbyNameTable;
@@ -1059,6 +1183,8 @@ void __not_in_flash_func(InfoNES_DrawLine)()
       const int bank = (ch >> 6) + bankOfsBG;
       const int addrOfs = ((ch & 63) << 4) + yOfsModBG;
       const auto data = PPUBANK[bank] + addrOfs;
+      XIP_READ(data);
+      XIP_READ(data + 8);
       const auto pl0 = data[0];
       const auto pl1 = data[8];
       // const auto pat0 = (pl0 & 0x55) | ((pl1 << 1) & 0xaa);
@@ -1101,7 +1227,7 @@ void __not_in_flash_func(InfoNES_DrawLine)()
 #endif
 
       // Callback at PPU read/write
-      MapperPPU(PATTBL(pbyChrData));
+      MapperPPU(PATTBL(nChrOfs));
 
       ++pbyNameTable;
     }
@@ -1136,7 +1262,7 @@ void __not_in_flash_func(InfoNES_DrawLine)()
 #endif
 
       // Callback at PPU read/write
-      MapperPPU(PATTBL(pbyChrData));
+      MapperPPU(PATTBL(nChrOfs));
 
       ++pbyNameTable;
     }
@@ -1159,6 +1285,8 @@ void __not_in_flash_func(InfoNES_DrawLine)()
       const int bank = (ch >> 6) + bankOfsBG;
       const int addrOfs = ((ch & 63) << 4) + yOfsModBG;
       const auto data = PPUBANK[bank] + addrOfs;
+      XIP_READ(data);
+      XIP_READ(data + 8);
       const auto pl0 = data[0];
       const auto pl1 = data[8];
       const auto pat0 = (pl0 & 0x55) | ((pl1 << 1) & 0xaa);
@@ -1191,7 +1319,7 @@ void __not_in_flash_func(InfoNES_DrawLine)()
 #endif
 
     // Callback at PPU read/write
-    MapperPPU(PATTBL(pbyChrData));
+    MapperPPU(PATTBL(nChrOfs));
 
     /*-------------------------------------------------------------------*/
     /*  Backgroud Clipping                                               */
@@ -1219,7 +1347,7 @@ void __not_in_flash_func(InfoNES_DrawLine)()
     }
   }
 
-  util::WorkMeterMark(MARKER_BG);
+  MARK_WORK(MARKER_BG, XIP_PHASE_BG);
 
   /*-------------------------------------------------------------------*/
   /*  Render a sprite                                                  */
@@ -1230,9 +1358,6 @@ void __not_in_flash_func(InfoNES_DrawLine)()
 
   if (PPU_R1 & R1_SHOW_SP)
   {
-    // Reset Scanline Sprite Count
-    PPU_R2 &= ~R2_MAX_SP;
-
     // Reset sprite buffer
     InfoNES_MemorySet(pSprBuf, 0, sizeof pSprBuf);
 
@@ -1241,7 +1366,7 @@ void __not_in_flash_func(InfoNES_DrawLine)()
 
     // Render a sprite to the sprite buffer
     nSprCnt = 0;
-    for (pSPRRAM = SPRRAM + (63 << 2); pSPRRAM >= SPRRAM; pSPRRAM -= 4)
+    for (pSPRRAM = SPRRAM + ((line.SprCount - 1) << 2); pSPRRAM >= SPRRAM; pSPRRAM -= 4)
     {
       nY = pSPRRAM[SPR_Y] + 1;
       if (nY > PPU_Scanline || nY + PPU_SP_Height <= PPU_Scanline)
@@ -1342,6 +1467,8 @@ void __not_in_flash_func(InfoNES_DrawLine)()
       const int bank = (ch >> 6) + bankOfs;
       const int addrOfs = ((ch & 63) << 4) + ((yOfsModSP & 8) << 1) + (yOfsModSP & 7);
       const auto data = PPUBANK[bank] + addrOfs;
+      XIP_READ(data);
+      XIP_READ(data + 8);
       const uint32_t pl0 = data[0];
       const uint32_t pl1 = data[8];
       const auto pat0 = ((pl0 & 0x55) << 24) | ((pl1 & 0x55) << 25);
@@ -1479,10 +1606,182 @@ void __not_in_flash_func(InfoNES_DrawLine)()
       InfoNES_MemorySet(pPointTop, 0, 8 << 1);
     }
 
-    if (nSprCnt >= 8)
-      PPU_R2 |= R2_MAX_SP; // Set a flag of maximum sprites on scanline
+    MARK_WORK(MARKER_SPRITE, XIP_PHASE_SPRITE);
+    return nSprCnt;
+  }
+  return -1;
+}
+
+#pragma pop_macro("PPU_Scanline")
+#pragma pop_macro("PPU_Addr")
+#pragma pop_macro("PPU_SP_Height")
+#pragma pop_macro("PPU_R0")
+#pragma pop_macro("PPU_R1")
+#pragma pop_macro("PPU_Scr_H_Byte")
+#pragma pop_macro("PPU_Scr_H_Bit")
+#pragma pop_macro("PPU_NameTableBank")
+#pragma pop_macro("PPU_UpDown_Clip")
+
+/*===================================================================*/
+/*                                                                   */
+/*   InfoNES_IsLineUnchanged() : Compare a scanline to last frame    */
+/*                                                                   */
+/*===================================================================*/
+#if defined(DIRTY_LINES)
+namespace
+{
+  inline DWORD sigMix(DWORD h, DWORD v)
+  {
+    // FNV-1a over words
+    return (h ^ v) * 16777619u;
+  }
+
+  inline DWORD sigMixBytes(DWORD h, const BYTE *p, int words)
+  {
+    for (int i = 0; i < words; ++i, p += 4)
+    {
+      DWORD v;
+      InfoNES_MemoryCopy(&v, p, 4); // name tables of some mappers are not word aligned
+      h = sigMix(h, v);
+    }
+    return h;
+  }
+}
+
+bool __not_in_flash_func(InfoNES_IsLineUnchanged)()
+{
+  /*
+   *  Compare a scanline to last frame
+   *
+   *  Return values
+   *    true  : Every input of the line matches the previous frame,
+   *            the line buffer on the screen can be kept as is.
+   *    false : The line has to be rendered.
+   *
+   *  Remarks
+   *    The signature covers scroll, PPU_R0/R1, the name table and
+   *    attribute rows, pattern/name table bank pointers, palette and
+   *    pattern generations and the sprites on the line.
+   */
+
+  // Mappers that switch banks while rendering are always redrawn
+  if (hasRenderHooks())
+  {
+    ++DirtyLineMisses;
+    return false;
+  }
+
+  DWORD h = 2166136261u;
+  h = sigMix(h, PPU_Addr | (PPU_Scr_H_Bit << 16) | (PPU_UpDown_Clip << 24));
+  h = sigMix(h, PPU_R0 | (PPU_R1 << 8));
+  h = sigMix(h, PalTableGen);
+  h = sigMix(h, PatternGen);
+
+  for (int nPage = 0; nPage < 12; ++nPage)
+  {
+    h = sigMix(h, reinterpret_cast<uintptr_t>(PPUBANK[nPage]));
+  }
+
+  if (PPU_R1 & R1_SHOW_SCR)
+  {
+    // Both name tables the line can scroll across
+    const int nY = (PPU_Addr >> 5) & 31;
+    const int nNameTable = NAME_TABLE0 + ((PPU_Addr >> 10) & 3);
+    for (int nSide = 0; nSide < 2; ++nSide)
+    {
+      const BYTE *pbyNameTable = PPUBANK[nNameTable ^ (nSide ? NAME_TABLE_H_MASK : 0)];
+      h = sigMixBytes(h, pbyNameTable + nY * 32, 32 / 4);
+      h = sigMixBytes(h, pbyNameTable + 0x3c0 + (nY / 4) * 8, 8 / 4);
+    }
+  }
+
+  if (PPU_R1 & R1_SHOW_SP)
+  {
+    for (const BYTE *pSPRRAM = SPRRAM; pSPRRAM < SPRRAM + SPRRAM_SIZE; pSPRRAM += 4)
+    {
+      int nY = pSPRRAM[SPR_Y] + 1;
+      if (nY > PPU_Scanline || nY + PPU_SP_Height <= PPU_Scanline)
+        continue; // Next sprite
+
+      h = sigMixBytes(h, pSPRRAM, 1);
+    }
+  }
 
-    util::WorkMeterMark(MARKER_SPRITE);
+  h |= 1; // 0 marks an invalid entry
+
+  DWORD &prev = PPU_LineSig[PPU_Scanline];
+  if (prev == h)
+  {
+    ++DirtyLineHits;
+    return true;
+  }
+  prev = h;
+  ++DirtyLineMisses;
+  return false;
+}
+#endif
+
+/*===================================================================*/
+/*                                                                   */
+/*    InfoNES_InvalidateLines() : Force scanlines to redraw          */
+/*                                                                   */
+/*===================================================================*/
+void InfoNES_InvalidateLines(int nFirst, int nCount)
+{
+  /*
+   *  Force scanlines to be rendered in the next frame
+   *
+   *  Parameters
+   *    int nFirst         (Read)
+   *      The first scanline
+   *
+   *    int nCount         (Read)
+   *      The number of scanlines
+   *
+   *  Remarks
+   *    Call this whenever the screen contents change outside of the
+   *    emulation, e.g. an overlay is drawn or removed. Only the lines
+   *    it covers need to be given.
+   */
+
+#if defined(DIRTY_LINES)
+  InfoNES_MemorySet(&PPU_LineSig[nFirst], 0, nCount * sizeof PPU_LineSig[0]);
+#endif
+}
+
+/*===================================================================*/
+/*                                                                   */
+/*  InfoNES_EvalSpriteLine() : Evaluate sprites on a skipped line    */
+/*                                                                   */
+/*===================================================================*/
+void __not_in_flash_func(InfoNES_EvalSpriteLine)()
+{
+  /*
+   *  Evaluate sprites on a scanline that is not rendered
+   *
+   *  Remarks
+   *    Sets the same sprite overflow flag as InfoNES_DrawLine() would,
+   *    without touching the line buffer.
+   */
+
+  if (!(PPU_R1 & R1_SHOW_SP))
+    return;
+
+  // Reset Scanline Sprite Count
+  PPU_R2 &= ~R2_MAX_SP;
+
+  int nSprCnt = 0;
+  for (BYTE *pSPRRAM = SPRRAM; pSPRRAM < SPRRAM + SPRRAM_SIZE; pSPRRAM += 4)
+  {
+    int nY = pSPRRAM[SPR_Y] + 1;
+    if (nY > PPU_Scanline || nY + PPU_SP_Height <= PPU_Scanline)
+      continue; // Next sprite
+
+    if (++nSprCnt >= 8)
+    {
+      PPU_R2 |= R2_MAX_SP; // Set a flag of maximum sprites on scanline
+      break;
+    }
   }
 }
 
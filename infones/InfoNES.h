@@ -15,21 +15,69 @@
 
 #include "InfoNES_Types.h"
 #include <cstddef>
+
+/*-------------------------------------------------------------------*/
+/*  Emulator state                                                   */
+/*-------------------------------------------------------------------*/
+
+/* The state the CPU reaches on its memory and I/O accesses, gathered in
+   one struct so that Thumb code loads a single base address instead of a
+   literal per variable. Fields are ordered by access frequency: the ones
+   used on every opcode fetch and PPU register access come first, where
+   they fit the 5 bit scaled offsets of ldrb / ldrh / ldr.
+   Every field keeps the name of the global it replaces, that name is now
+   a macro for the field. */
+struct InfoNES_State_tag
+{
+  /* Offset 0: ROM banks, read by every opcode fetch */
+  BYTE *ROMBANK[4];
+
+  /* Offset 16: PPU registers ( $2000-$2007 ) */
+  WORD PPU_Addr;
+  WORD PPU_Temp;
+  WORD PPU_Increment;
+  BYTE PPU_R0;
+  BYTE PPU_R1;
+  BYTE PPU_R2;
+  BYTE PPU_R3;
+  BYTE PPU_R7;
+  BYTE PPU_Latch_Flag;
+  BYTE PPU_Scr_H_Byte;
+  BYTE PPU_Scr_H_Bit;
+  BYTE PPU_NameTableBank;
+  BYTE byVramWriteEnable;
+  WORD PPU_BG_Base;
+  WORD PPU_SP_Base;
+
+  /* Offset 36: once per scanline */
+  WORD PPU_Scanline;
+  WORD PPU_SP_Height;
+  WORD FrameStep;
+  BYTE FrameIRQ_Enable;
+  BYTE PPU_UpDown_Clip;
+
+  /* Offset 44: pads ( $4016, $4017 ) */
+  DWORD PAD1_Latch;
+  DWORD PAD2_Latch;
+  DWORD PAD1_Bit;
+  DWORD PAD2_Bit;
+  DWORD PAD_System;
+};
+
+extern struct InfoNES_State_tag InfoNES_State;
 /*-------------------------------------------------------------------*/
 /*  NES resources                                                    */
 /*-------------------------------------------------------------------*/
 
-#define RAM_SIZE 0x2000
+#define RAM_SIZE 0x800
 #define SRAM_SIZE 0x2000
 #define PPURAM_SIZE 0x4000
 #define SPRRAM_SIZE 256
-#define CHRBUF_SIZE 256 * 2 * 8 * 8
 
-/* RAM */
-extern BYTE *RAM;
-// extern BYTE *RAM;
+/* RAM ( 0x800 - 0x1fff is a mirror, never stored ) */
+extern BYTE RAM[];
 /* SRAM */
-extern BYTE *SRAM;
+extern BYTE SRAM[];
 
 extern bool SRAMwritten;
 
@@ -40,7 +88,7 @@ extern BYTE *ROM;
 extern BYTE *SRAMBANK;
 
 /* ROM BANK ( 8Kb * 4 ) */
-extern BYTE *ROMBANK[4];
+#define ROMBANK (InfoNES_State.ROMBANK)
 // extern BYTE *ROMBANK0;
 // extern BYTE *ROMBANK1;
 // extern BYTE *ROMBANK2;
@@ -55,8 +103,7 @@ extern BYTE *ROMBANK[4];
 /*-------------------------------------------------------------------*/
 
 /* PPU RAM */
-extern BYTE *PPURAM;
-//extern BYTE *PPURAM;
+extern BYTE PPURAM[];
 /* VROM */
 extern BYTE *VROM;
 
@@ -72,7 +119,7 @@ extern BYTE *PPUBANK[];
 #define NAME_TABLE_H_MASK 1
 
 /* Sprite RAM */
-extern BYTE *SPRRAM;
+extern BYTE SPRRAM[];
 
 #define SPR_Y 0
 #define SPR_CHR 1
@@ -84,11 +131,11 @@ extern BYTE *SPRRAM;
 #define SPR_ATTR_PRI 0x20
 
 /* PPU Register */
-extern BYTE PPU_R0;
-extern BYTE PPU_R1;
-extern BYTE PPU_R2;
-extern BYTE PPU_R3;
-extern BYTE PPU_R7;
+#define PPU_R0 (InfoNES_State.PPU_R0)
+#define PPU_R1 (InfoNES_State.PPU_R1)
+#define PPU_R2 (InfoNES_State.PPU_R2)
+#define PPU_R3 (InfoNES_State.PPU_R3)
+#define PPU_R7 (InfoNES_State.PPU_R7)
 
 //extern BYTE PPU_Scr_V;
 //extern BYTE PPU_Scr_V_Next;
@@ -99,18 +146,17 @@ extern BYTE PPU_R7;
 
 //extern BYTE PPU_Scr_H;
 //extern BYTE PPU_Scr_H_Next;
-extern BYTE PPU_Scr_H_Byte;
+#define PPU_Scr_H_Byte (InfoNES_State.PPU_Scr_H_Byte)
 //extern BYTE PPU_Scr_H_Byte_Next;
-extern BYTE PPU_Scr_H_Bit;
+#define PPU_Scr_H_Bit (InfoNES_State.PPU_Scr_H_Bit)
 //extern BYTE PPU_Scr_H_Bit_Next;
 
-extern BYTE PPU_Latch_Flag;
-extern WORD PPU_Addr;
-extern WORD PPU_Temp;
-extern WORD PPU_Increment;
+#define PPU_Latch_Flag (InfoNES_State.PPU_Latch_Flag)
+#define PPU_Addr (InfoNES_State.PPU_Addr)
+#define PPU_Temp (InfoNES_State.PPU_Temp)
+#define PPU_Increment (InfoNES_State.PPU_Increment)
 
-extern BYTE PPU_Latch_Flag;
-extern BYTE PPU_UpDown_Clip;
+#define PPU_UpDown_Clip (InfoNES_State.PPU_UpDown_Clip)
 
 #define R0_NMI_VB 0x80
 #define R0_NMI_SP 0x40
@@ -171,33 +217,33 @@ extern BYTE PPU_UpDown_Clip;
 #endif
 
 /* Current Scanline */
-extern WORD PPU_Scanline;
+#define PPU_Scanline (InfoNES_State.PPU_Scanline)
 
 /* Scanline Table */
 extern BYTE PPU_ScanTable[];
 
 /* Name Table Bank */
-extern BYTE PPU_NameTableBank;
+#define PPU_NameTableBank (InfoNES_State.PPU_NameTableBank)
 
-/* BG Base Address */
-extern BYTE *PPU_BG_Base;
+/* BG Base Address, pattern table 0 or 1 as an offset of 256 * 64 */
+#define PPU_BG_Base (InfoNES_State.PPU_BG_Base)
 
 /* Sprite Base Address */
-extern BYTE *PPU_SP_Base;
+#define PPU_SP_Base (InfoNES_State.PPU_SP_Base)
 
 /* Sprite Height */
-extern WORD PPU_SP_Height;
+#define PPU_SP_Height (InfoNES_State.PPU_SP_Height)
 
 /* NES display size */
 #define NES_DISP_WIDTH 256
 #define NES_DISP_HEIGHT 240
 
 /* VRAM Write Enable ( 0: Disable, 1: Enable ) */
-extern BYTE byVramWriteEnable;
+#define byVramWriteEnable (InfoNES_State.byVramWriteEnable)
 
 /* Frame IRQ ( 0: Disabled, 1: Enabled )*/
-extern BYTE FrameIRQ_Enable;
-extern WORD FrameStep;
+#define FrameIRQ_Enable (InfoNES_State.FrameIRQ_Enable)
+#define FrameStep (InfoNES_State.FrameStep)
 
 /*-------------------------------------------------------------------*/
 /*  Display and Others resouces                                      */
@@ -216,13 +262,20 @@ extern WORD WorkFrameIdx;
 // FHextern WORD WorkFrame[NES_DISP_WIDTH * NES_DISP_HEIGHT];
 #endif
 
-extern BYTE *ChrBuf;
-
-
 extern BYTE ChrBufUpdate;
 
 extern WORD PalTable[];
 
+/* Generation counters of PalTable and the pattern tables */
+extern DWORD PalTableGen;
+extern DWORD PatternGen;
+
+#if defined(DIRTY_LINES)
+/* Skipped / redrawn scanline counters of the dirty line detection */
+extern DWORD DirtyLineHits;
+extern DWORD DirtyLineMisses;
+#endif
+
 /*-------------------------------------------------------------------*/
 /*  APU and Pad resources                                            */
 /*-------------------------------------------------------------------*/
@@ -230,11 +283,11 @@ extern WORD PalTable[];
 extern BYTE APU_Reg[];
 extern int APU_Mute;
 
-extern DWORD PAD1_Latch;
-extern DWORD PAD2_Latch;
-extern DWORD PAD_System;
-extern DWORD PAD1_Bit;
-extern DWORD PAD2_Bit;
+#define PAD1_Latch (InfoNES_State.PAD1_Latch)
+#define PAD2_Latch (InfoNES_State.PAD2_Latch)
+#define PAD_System (InfoNES_State.PAD_System)
+#define PAD1_Bit (InfoNES_State.PAD1_Bit)
+#define PAD2_Bit (InfoNES_State.PAD2_Bit)
 
 #define PAD_SYS_QUIT 1
 #define PAD_SYS_OK 2
@@ -327,9 +380,57 @@ void InfoNES_Cycle();
 /* A function in H-Sync */
 int InfoNES_HSync();
 
+/* PPU state a scanline is rendered from, the memories by pointer */
+struct PpuLine
+{
+  WORD *WorkLine;
+  BYTE *const *Bank; /* PPUBANK, or CapturedLine::Banks */
+  const WORD *Pal;   /* PalTable, or CapturedLine::Palette */
+  const BYTE *Spr;   /* SPRRAM, or CapturedLine::Sprites */
+  int SprCount;      /* Sprites in Spr */
+  int Scanline;
+  WORD Addr;
+  WORD SPHeight;
+  BYTE R0;
+  BYTE R1;
+  BYTE ScrHByte;
+  BYTE ScrHBit;
+  BYTE NameTableBank;
+  BYTE UpDownClip;
+};
+
+/* A scanline captured to be rendered later, with its own copies */
+struct CapturedLine : PpuLine
+{
+  BYTE *Banks[16];
+  WORD Palette[32];
+  BYTE Sprites[SPRRAM_SIZE];
+};
+
 /* Render a scanline */
 void InfoNES_DrawLine();
 
+#if defined(PPU_CORE1)
+/* Capture the PPU state of a scanline to render it later on the other core */
+void InfoNES_CaptureLine(CapturedLine &line);
+
+/* Render a captured scanline */
+void InfoNES_DrawLine(const PpuLine &line);
+#endif
+
+/* Evaluate sprites on a scanline that is not rendered */
+void InfoNES_EvalSpriteLine();
+
+/* Compare the inputs of a scanline to the previous frame */
+#if defined(DIRTY_LINES)
+bool InfoNES_IsLineUnchanged();
+#else
+inline bool InfoNES_IsLineUnchanged() { return false; }
+#endif
+
+/* Force nCount scanlines from nFirst ( all by default ) to redraw in the next frame */
+void InfoNES_InvalidateLines(int nFirst = 0, int nCount = NES_DISP_HEIGHT);
+
 /* Get a position of scanline hits sprite #0 */
 void InfoNES_GetSprHitY();
 
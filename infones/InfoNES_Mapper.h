@@ -19,14 +19,37 @@
 /*  Constants                                                        */
 /*-------------------------------------------------------------------*/
 
-#define DRAM_SIZE 0xA000
+#define DRAM_SIZE 0x2000
 
 /*-------------------------------------------------------------------*/
 /*  Mapper resources                                                 */
 /*-------------------------------------------------------------------*/
 
-/* Disk System RAM */
-extern BYTE DRAM[];
+/* Work RAM of the mappers that need more than registers. Only one
+   mapper runs at a time, so they share one static union as large as
+   the biggest enabled member, cleared by InfoNES_Reset(). The mappers
+   reach their member through a macro with the old array name. */
+union MapperRam_tag
+{
+  /* Disk System RAM */
+  BYTE DRAM[DRAM_SIZE];
+  BYTE Map19_Chr_Ram[0x2000];
+  BYTE Map185_Dummy_Chr_Rom[0x400];
+  BYTE Map188_Dummy[0x2000];
+#if NES_MAPPER_5_ENABLED == 1
+  struct
+  {
+    BYTE Wram[0x2000 * 8];
+    BYTE Ex_Ram[0x400];
+    BYTE Ex_Vram[0x400];
+    BYTE Ex_Nam[0x400];
+  } Map5;
+#endif
+};
+
+extern union MapperRam_tag MapperRam;
+
+#define DRAM (MapperRam.DRAM)
 
 /*-------------------------------------------------------------------*/
 /*  Macros                                                           */
@@ -42,8 +65,8 @@ extern BYTE DRAM[];
 #define CRAMPAGE(a) &PPURAM[0x0000 + ((a)&0x1F) * 0x400]
 /* The address of 1Kbytes unit of the VRAM */
 #define VRAMPAGE(a) &PPURAM[0x2000 + (a)*0x400]
-/* Translate the pointer to ChrBuf into the address of Pattern Table */
-#define PATTBL(a) (((a)-ChrBuf) >> 2)
+/* Translate the offset of a decoded pattern ( 64 bytes per tile ) into the address of Pattern Table */
+#define PATTBL(a) ((a) >> 2)
 
 /*-------------------------------------------------------------------*/
 /*  Table of Mapper initialize function                              */
@@ -39,6 +39,9 @@ int InfoNES_LoadFrame();
 /* Get a joypad state */
 void InfoNES_PadState(DWORD *pdwPad1, DWORD *pdwPad2, DWORD *pdwSystem);
 
+/* Latch the joypads when the game strobes $4016 */
+void InfoNES_PadLatch(DWORD *pdwPad1, DWORD *pdwPad2);
+
 /* memcpy */
 inline void *InfoNES_MemoryCopy(void *dest, const void *src, int count)
 {
@@ -68,15 +71,70 @@ int InfoNES_SoundOpen(int samples_per_sync, int sample_rate);
 /* Sound Close */
 void InfoNES_SoundClose(void);
 
-/* Sound Output 5 Waves - 2 Pulse, 1 Triangle, 1 Noise, 1 DPCM */
+/* Sound Output 5 Waves - 2 Pulse, 1 Triangle, 1 Noise, 1 DPCM ( DAC levels ) */
 void InfoNES_SoundOutput(int samples, BYTE *wave1, BYTE *wave2, BYTE *wave3, BYTE *wave4, BYTE *wave5);
 int InfoNES_GetSoundBufferSize();
 
+/* Direct access to the output ring, stereo frames packed as ( right << 16 ) | left */
+DWORD *InfoNES_SoundLockBuffer(int samples, int *locked);
+void InfoNES_SoundUnlockBuffer(int samples);
+
+/* Sample rate trim for the next frame in 1/65536ths, keeps the output ring from running full or dry */
+int InfoNES_SoundRateTrim(void);
+
+/* Non-linear mixer tables ( pulse: p1 * 16 + p2, tnd: 3 * t + 2 * n + d ) */
+extern DWORD SoundPulseMix[16 * 16];
+extern DWORD SoundTndMix[203];
+
 /* Print system message */
 void InfoNES_MessageBox(const char *pszMsg, ...);
 
 void InfoNES_Error(const char *pszMsg, ...);
+/* Whether a scanline survives the screen's downscaling ( false: not rendered
+   unless the mapper hooks rendering ) */
+bool InfoNES_IsLineVisible(int line);
 void InfoNES_PreDrawLine(int line);
 void InfoNES_PostDrawLine(int line);
 
+#if defined(PPU_CORE1)
+/* Where to capture a scanline that is rendered on the other core ( nullptr: render it now ) */
+struct CapturedLine;
+CapturedLine *InfoNES_DeferDrawLine(int line);
+
+/* Wait until every captured scanline is rendered, before PPU memory changes under it */
+void InfoNES_WaitDrawLine();
+#endif
+
+#if defined(ROM_CACHE)
+/* Point the ROM and VROM banks a mapper switched to at their copies in RAM ( see rom_cache.h ) */
+void InfoNES_BankSync();
+
+/* The same for banks already in RAM, the others wait for InfoNES_BankSync() */
+void InfoNES_BankRemap();
+#endif
+
+/* Work phases the XIP cache accesses are charged to ( see xip_stats.h ) */
+enum
+{
+  XIP_PHASE_OTHER,  /* Frame pacing, line buffers, everything between lines */
+  XIP_PHASE_CPU,    /* K6502_Step() */
+  XIP_PHASE_APU,    /* MapperHSync() and InfoNES_pAPUHsync() */
+  XIP_PHASE_BG,     /* Background rendering */
+  XIP_PHASE_SPRITE, /* Sprite rendering */
+  XIP_PHASE_COUNT
+};
+
+#if defined(XIP_STATS)
+/* End of a work phase, the accesses since the previous call belong to it */
+void InfoNES_XipPhase(int nPhase);
+#endif
+
+#if defined(XIP_STATS) && !PICO_ON_DEVICE
+/* A byte read from the ROM, for the host's XIP cache model */
+void InfoNES_XipRead(const void *pAddr);
+#define XIP_READ(pAddr) InfoNES_XipRead(pAddr)
+#else
+#define XIP_READ(pAddr) ((void)0)
+#endif
+
 #endif /* !InfoNES_SYSTEM_H_INCLUDED */
@@ -31,4 +31,18 @@ typedef unsigned char  BYTE;
 #define NULL  0
 #endif /* !NULL */
 
+/*-------------------------------------------------------------------*/
+/*  Memory placement                                                 */
+/*-------------------------------------------------------------------*/
+/* Definitions of the state core 0 reaches on nearly every opcode. With
+   SCRATCH_STATE they go to scratch bank Y beside the core 0 stack, where
+   neither core 1 nor the DMA ever stall them. Everything else, the line
+   buffers and the audio ring included, stays in the striped main SRAM.
+   Scratch Y is 4K and the core 0 stack takes half, keep this small. */
+#if defined(SCRATCH_STATE)
+#define __core0_state(group) __scratch_y(group)
+#else
+#define __core0_state(group)
+#endif
+
 #endif /* !InfoNES_TYPES_H_INCLUDED */
@@ -14,23 +14,85 @@
 #include "InfoNES_System.h"
 #include "InfoNES_pAPU.h"
 #include <algorithm>
+#include <math.h>
 #include <string.h>
+#if defined(APU_CORE1)
+#include <atomic>
+#include "hardware/sync.h"
+#endif
 
 /*-------------------------------------------------------------------*/
 /*   APU Event resources                                             */
 /*-------------------------------------------------------------------*/
 
+#if defined(APU_CORE1)
+/* Batches of samples to render on the other core, with their writes */
+struct ApuBatch_t
+{
+  struct ApuEvent_t events[APU_EVENT_MAX];
+  int count;
+  int samples;
+  bool enabled;
+  bool vsync; /* Run the frame counter step after the batch */
+};
+static struct ApuBatch_t ApuBatches[APU_CORE1_BATCHES];
+static std::atomic<DWORD> ApuBatchHead; /* Published by the CPU core */
+static std::atomic<DWORD> ApuBatchTail; /* Rendered by the other core */
+
+/* The CPU core queues its writes straight into the next batch */
+struct ApuEvent_t *ApuEventQueue = ApuBatches[0].events;
+#else
 struct ApuEvent_t ApuEventQueue[APU_EVENT_MAX];
+#endif
 int cur_event;
 WORD entertime;
 
+/* The writes of the batch being rendered */
+static const struct ApuEvent_t *ApuRenderEvents;
+static int ApuRenderEventCount;
+
+/* Sample index of the next queued write, or n if there is none */
+static inline int ApuNextEventSample(int event, int n)
+{
+  return event < ApuRenderEventCount ? std::min<int>(ApuRenderEvents[event].time, n) : n;
+}
+
+/*
+ *  Samples, counting the one at `index`, until a 32-step wave changes
+ *  its level ( wave[] >> 4 ), at most max
+ */
+static inline int ApuPhaseRun(DWORD index, DWORD skip, const BYTE *wave, int max)
+{
+  if (!skip)
+    return max;
+
+  int idx = index >> 24;
+  int level = wave[idx] >> 4;
+  int edge = idx + 1;
+  while (edge < idx + 32 && (wave[edge & 31] >> 4) == level)
+    edge++;
+
+  DWORD run = ((DWORD)edge << 24) - 1 - index;
+  run = run / skip + 1;
+  return run < (DWORD)max ? run : max;
+}
+
 /*-------------------------------------------------------------------*/
 /*   APU Register Write Functions                                    */
 /*-------------------------------------------------------------------*/
 
+#if defined(APU_CORE1)
+static void ApuStatusWrite(BYTE type, BYTE data);
+#else
+static inline void ApuStatusWrite(BYTE type, BYTE data) {}
+#endif
+
 #define APU_WRITEFUNC(name, evtype)                                \
   void ApuWrite##name(WORD addr, BYTE value)                       \
   {                                                                \
+    ApuStatusWrite(APUET_W_##evtype, value);                       \
+    if (cur_event >= APU_EVENT_MAX)                                \
+      InfoNES_pAPUFlush();                                         \
     ApuEventQueue[cur_event].time = getPassedClocks() - entertime; \
     ApuEventQueue[cur_event].type = APUET_W_##evtype;              \
     ApuEventQueue[cur_event].data = value;                         \
@@ -94,7 +156,10 @@ ApuWritefunc pAPUSoundRegs[20] =
 /*   APU resources                                                   */
 /*-------------------------------------------------------------------*/
 
-BYTE wave_buffers[5][735]; /* 44100 / 60 = 735 samples per sync */
+#if defined(APU_SPLIT_CHANNELS)
+/* Per channel DAC levels, for debugging and capture */
+BYTE wave_buffers[5][APU_WAVE_BUFFER_SIZE]; /* 44100 / 60 = 735 samples per sync */
+#endif
 
 BYTE ApuCtrl;
 BYTE ApuCtrlNew;
@@ -104,6 +169,8 @@ BYTE ApuCtrlNew;
 /*-------------------------------------------------------------------*/
 
 int ApuQuality;
+int ApuQualityNext = pAPU_QUALITY;
+bool ApuBlep;
 
 DWORD ApuPulseMagic;
 DWORD ApuTriangleMagic;
@@ -122,13 +189,17 @@ struct ApuQualityData_t
   unsigned int cycles_per_sample;
   unsigned int sample_rate;
   DWORD cycle_rate;
+  bool blep;
 } ApuQual[] = {
+    {0, 0, 0, 0, 41, 44100, 2659741, false}, /* Off: registers only */
     // {0xa2567000, 0xa2567000, 0xa2567000, 183, 164, 11025, 1062658},
     // {0x512b3800, 0x512b3800, 0x512b3800, 367, 82, 22050, 531329},
     // {0x289d9c00, 0x289d9c00, 0x289d9c00, 735, 41, 44100, 265664},
-    {0xa2567000, 0xa2567000, 0xa2567000, 45963, 164, 11025, 664935},
-    {0x512b3800, 0x512b3800, 0x512b3800, 91926, 82, 22050, 1329870},
-    {0x289d9c00, 0x289d9c00, 0x289d9c00, 184402, 41, 44100, 2659741},
+    {0xa2567000, 0xa2567000, 0xa2567000, 46101, 164, 11025, 10638962, false},
+    {0x512b3800, 0x512b3800, 0x512b3800, 92201, 82, 22050, 5319481, false},
+    {0x289d9c00, 0x289d9c00, 0x289d9c00, 184402, 41, 44100, 2659741, false},
+    {0xa2567000, 0xa2567000, 0xa2567000, 46101, 164, 11025, 10638962, true},
+    {0x512b3800, 0x512b3800, 0x512b3800, 92201, 82, 22050, 5319481, true},
 };
 
 // 44100/60/262*65536 = 183850.99236641222
@@ -137,6 +208,10 @@ struct ApuQualityData_t
 
 // cycle_rate
 // 1789773 / 44100 * 65536 = 2659740.665034014
+// 1789773 / 22050 * 65536 = 5319481.330068027
+// 1789773 / 11025 * 65536 = 10638962.660136054
+
+static void ApuSetQuality(int quality);
 
 /*-------------------------------------------------------------------*/
 /*  Rectangle Wave #1 resources                                      */
@@ -208,6 +283,12 @@ int ApuC5Phaseacc;
 WORD ApuC5Address, ApuC5CacheAddr;
 int ApuC5DmaLength, ApuC5CacheDmaLength;
 
+/* Samples are streamed from the ROM bank holding ApuC5Address */
+BYTE *const *ApuC5Slot = &ROMBANK[0]; /* ROMBANK entry the pointer came from */
+BYTE *ApuC5Bank;                     /* Its value then, a mapper switch changes it */
+const BYTE *ApuC5Ptr;                /* Next sample byte */
+int ApuC5Left;                       /* Bytes left in the bank, 0: resolve again */
+
 /*-------------------------------------------------------------------*/
 /*  Wave Data                                                        */
 /*-------------------------------------------------------------------*/
@@ -465,26 +546,26 @@ DWORD __not_in_flash_func(ApuDpcmCycles)[16] =
 /* Write registers of rectangular wave #1                            */
 /*-------------------------------------------------------------------*/
 
-int __not_in_flash_func(ApuWriteWave1)(int cycles, int event)
+int __not_in_flash_func(ApuWriteWave1)(int sample, int event)
 {
   /* APU Reg Write Event */
-  while ((event < cur_event) && (ApuEventQueue[event].time < cycles))
+  while ((event < ApuRenderEventCount) && (ApuRenderEvents[event].time < sample))
   {
-    if ((ApuEventQueue[event].type & APUET_MASK) == APUET_C1)
+    if ((ApuRenderEvents[event].type & APUET_MASK) == APUET_C1)
     {
-      switch (ApuEventQueue[event].type & 0x03)
+      switch (ApuRenderEvents[event].type & 0x03)
       {
       case 0:
-        ApuC1a = ApuEventQueue[event].data;
+        ApuC1a = ApuRenderEvents[event].data;
         ApuC1Wave = pulse_waves[ApuC1DutyCycle >> 6];
         break;
 
       case 1:
-        ApuC1b = ApuEventQueue[event].data;
+        ApuC1b = ApuRenderEvents[event].data;
         break;
 
       case 2:
-        ApuC1c = ApuEventQueue[event].data;
+        ApuC1c = ApuRenderEvents[event].data;
         ApuC1Freq = ((((WORD)ApuC1d & 0x07) << 8) + ApuC1c);
         ApuC1Atl = ApuAtl[(ApuC1d & 0xf8) >> 3];
 
@@ -499,7 +580,7 @@ int __not_in_flash_func(ApuWriteWave1)(int cycles, int event)
         break;
 
       case 3:
-        ApuC1d = ApuEventQueue[event].data;
+        ApuC1d = ApuRenderEvents[event].data;
         ApuC1Freq = ((((WORD)ApuC1d & 0x07) << 8) + ApuC1c);
         ApuC1Atl = ApuAtl[(ApuC1d & 0xf8) >> 3];
 
@@ -516,11 +597,11 @@ int __not_in_flash_func(ApuWriteWave1)(int cycles, int event)
         break;
       }
     }
-    else if (ApuEventQueue[event].type == APUET_W_CTRL)
+    else if (ApuRenderEvents[event].type == APUET_W_CTRL)
     {
-      ApuCtrlNew = ApuEventQueue[event].data;
+      ApuCtrlNew = ApuRenderEvents[event].data;
 
-      if (!(ApuEventQueue[event].data & (1 << 0)))
+      if (!(ApuRenderEvents[event].data & (1 << 0)))
       {
         ApuC1Atl = 0;
       }
@@ -534,28 +615,66 @@ int __not_in_flash_func(ApuWriteWave1)(int cycles, int event)
 /* Rendering rectangular wave #1                                     */
 /*-------------------------------------------------------------------*/
 
+/* Volume while rectangular wave #1 sounds, -1 when it is silent */
+static inline int ApuC1Level()
+{
+  if ((ApuCtrlNew & 0x01) && (ApuC1Atl || ApuC1Hold) &&
+      !(ApuC1Freq < 8 || (!ApuC1SweepIncDec && ApuC1Freq > ApuC1FreqLimit)))
+  {
+    return ApuC1Env ? ApuC1Vol : ApuC1EnvVol;
+  }
+  return -1;
+}
+
+/* Render the next samples up to a phase edge, returns the count ( 1-max ) */
+static inline int ApuC1Run(int vol, int max, int *level)
+{
+  ApuC1Index += ApuC1Skip;
+  ApuC1Index &= 0x1fffffff;
+  *level = ApuC1Wave[ApuC1Index >> 24] ? vol : 0;
+
+  /* A zero volume is silent whatever the phase */
+  int n = vol ? ApuPhaseRun(ApuC1Index, ApuC1Skip, ApuC1Wave, max) : max;
+  ApuC1Index += ApuC1Skip * (n - 1);
+  ApuC1Index &= 0x1fffffff;
+  return n;
+}
+
+#if defined(APU_SPLIT_CHANNELS)
 void __not_in_flash_func(ApuRenderingWave1)(int n)
 {
   ApuCtrlNew = ApuCtrl;
-  ApuWriteWave1(ApuCyclesPerSample * (n + 1), 0);
 
-  if ((ApuCtrlNew & 0x01) && (ApuC1Atl || ApuC1Hold) &&
-      !(ApuC1Freq < 8 || (!ApuC1SweepIncDec && ApuC1Freq > ApuC1FreqLimit)))
+  int event = 0;
+  for (int i = 0; i < n;)
   {
-    auto vol = ApuC1Env ? ApuC1Vol : ApuC1EnvVol;
-    for (unsigned int i = 0; i < n; i++)
+    /* Apply the writes up to this sample, render until the next one */
+    event = ApuWriteWave1(i + 1, event);
+    int end = ApuNextEventSample(event, n);
+
+    int vol = ApuC1Level();
+    if (vol >= 0)
     {
-      /* Wave Rendering */
-      ApuC1Index += ApuC1Skip;
-      ApuC1Index &= 0x1fffffff;
-      wave_buffers[0][i] = ApuC1Wave[ApuC1Index >> 24] * vol;
+      while (i < end)
+      {
+        /* Wave Rendering */
+        int level;
+        int run = ApuC1Run(vol, end - i, &level);
+        memset(&wave_buffers[0][i], level, run);
+        i += run;
+      }
+    }
+    else
+    {
+      memset(&wave_buffers[0][i], 0, end - i);
+      i = end;
     }
   }
-  else
-  {
-    memset(wave_buffers[0], 0, 2 * n);
-  }
+
+  /* Writes after the last rendered sample */
+  ApuWriteWave1(APU_EVENT_TIME_MAX, event);
 }
+#endif
 
 /*===================================================================*/
 /*                                                                   */
@@ -567,26 +686,26 @@ void __not_in_flash_func(ApuRenderingWave1)(int n)
 /* Write registers of rectangular wave #2                           */
 /*-------------------------------------------------------------------*/
 
-int __not_in_flash_func(ApuWriteWave2)(int cycles, int event)
+int __not_in_flash_func(ApuWriteWave2)(int sample, int event)
 {
   /* APU Reg Write Event */
-  while ((event < cur_event) && (ApuEventQueue[event].time < cycles))
+  while ((event < ApuRenderEventCount) && (ApuRenderEvents[event].time < sample))
   {
-    if ((ApuEventQueue[event].type & APUET_MASK) == APUET_C2)
+    if ((ApuRenderEvents[event].type & APUET_MASK) == APUET_C2)
     {
-      switch (ApuEventQueue[event].type & 0x03)
+      switch (ApuRenderEvents[event].type & 0x03)
       {
       case 0:
-        ApuC2a = ApuEventQueue[event].data;
+        ApuC2a = ApuRenderEvents[event].data;
         ApuC2Wave = pulse_waves[ApuC2DutyCycle >> 6];
         break;
 
       case 1:
-        ApuC2b = ApuEventQueue[event].data;
+        ApuC2b = ApuRenderEvents[event].data;
         break;
 
       case 2:
-        ApuC2c = ApuEventQueue[event].data;
+        ApuC2c = ApuRenderEvents[event].data;
         ApuC2Freq = ((((WORD)ApuC2d & 0x07) << 8) + ApuC2c);
         ApuC2Atl = ApuAtl[(ApuC2d & 0xf8) >> 3];
 
@@ -601,7 +720,7 @@ int __not_in_flash_func(ApuWriteWave2)(int cycles, int event)
         break;
 
       case 3:
-        ApuC2d = ApuEventQueue[event].data;
+        ApuC2d = ApuRenderEvents[event].data;
         ApuC2Freq = ((((WORD)ApuC2d & 0x07) << 8) + ApuC2c);
         ApuC2Atl = ApuAtl[(ApuC2d & 0xf8) >> 3];
 
@@ -617,11 +736,11 @@ int __not_in_flash_func(ApuWriteWave2)(int cycles, int event)
         break;
       }
     }
-    else if (ApuEventQueue[event].type == APUET_W_CTRL)
+    else if (ApuRenderEvents[event].type == APUET_W_CTRL)
     {
-      ApuCtrlNew = ApuEventQueue[event].data;
+      ApuCtrlNew = ApuRenderEvents[event].data;
 
-      if (!(ApuEventQueue[event].data & (1 << 1)))
+      if (!(ApuRenderEvents[event].data & (1 << 1)))
       {
         ApuC2Atl = 0;
       }
@@ -635,28 +754,66 @@ int __not_in_flash_func(ApuWriteWave2)(int cycles, int event)
 /* Rendering rectangular wave #2                                     */
 /*-------------------------------------------------------------------*/
 
+/* Volume while rectangular wave #2 sounds, -1 when it is silent */
+static inline int ApuC2Level()
+{
+  if ((ApuCtrlNew & 0x02) && (ApuC2Atl || ApuC2Hold) &&
+      !(ApuC2Freq < 8 || (!ApuC2SweepIncDec && ApuC2Freq > ApuC2FreqLimit)))
+  {
+    return ApuC2Env ? ApuC2Vol : ApuC2EnvVol;
+  }
+  return -1;
+}
+
+/* Render the next samples up to a phase edge, returns the count ( 1-max ) */
+static inline int ApuC2Run(int vol, int max, int *level)
+{
+  ApuC2Index += ApuC2Skip;
+  ApuC2Index &= 0x1fffffff;
+  *level = ApuC2Wave[ApuC2Index >> 24] ? vol : 0;
+
+  /* A zero volume is silent whatever the phase */
+  int n = vol ? ApuPhaseRun(ApuC2Index, ApuC2Skip, ApuC2Wave, max) : max;
+  ApuC2Index += ApuC2Skip * (n - 1);
+  ApuC2Index &= 0x1fffffff;
+  return n;
+}
+
+#if defined(APU_SPLIT_CHANNELS)
 void __not_in_flash_func(ApuRenderingWave2)(int n)
 {
   ApuCtrlNew = ApuCtrl;
-  ApuWriteWave2(ApuCyclesPerSample * (n + 1), 0);
 
-  if ((ApuCtrlNew & 0x02) && (ApuC2Atl || ApuC2Hold) &&
-      !(ApuC2Freq < 8 || (!ApuC2SweepIncDec && ApuC2Freq > ApuC2FreqLimit)))
+  int event = 0;
+  for (int i = 0; i < n;)
   {
-    auto vol = ApuC2Env ? ApuC2Vol : ApuC2EnvVol;
-    for (unsigned int i = 0; i < n; i++)
+    /* Apply the writes up to this sample, render until the next one */
+    event = ApuWriteWave2(i + 1, event);
+    int end = ApuNextEventSample(event, n);
+
+    int vol = ApuC2Level();
+    if (vol >= 0)
     {
-      /* Wave Rendering */
-      ApuC2Index += ApuC2Skip;
-      ApuC2Index &= 0x1fffffff;
-      wave_buffers[1][i] = ApuC2Wave[ApuC2Index >> 24] * vol;
+      while (i < end)
+      {
+        /* Wave Rendering */
+        int level;
+        int run = ApuC2Run(vol, end - i, &level);
+        memset(&wave_buffers[1][i], level, run);
+        i += run;
+      }
+    }
+    else
+    {
+      memset(&wave_buffers[1][i], 0, end - i);
+      i = end;
     }
   }
-  else
-  {
-    memset(wave_buffers[1], 0, 2 * n);
-  }
+
+  /* Writes after the last rendered sample */
+  ApuWriteWave2(APU_EVENT_TIME_MAX, event);
 }
+#endif
 
 /*===================================================================*/
 /*                                                                   */
@@ -668,25 +825,25 @@ void __not_in_flash_func(ApuRenderingWave2)(int n)
 /* Write registers of triangle wave #3                              */
 /*-------------------------------------------------------------------*/
 
-int __not_in_flash_func(ApuWriteWave3)(int cycles, int event)
+int __not_in_flash_func(ApuWriteWave3)(int sample, int event)
 {
   /* APU Reg Write Event */
-  while ((event < cur_event) && (ApuEventQueue[event].time < cycles))
+  while ((event < ApuRenderEventCount) && (ApuRenderEvents[event].time < sample))
   {
-    if ((ApuEventQueue[event].type & APUET_MASK) == APUET_C3)
+    if ((ApuRenderEvents[event].type & APUET_MASK) == APUET_C3)
     {
-      switch (ApuEventQueue[event].type & 3)
+      switch (ApuRenderEvents[event].type & 3)
       {
       case 0:
-        ApuC3a = ApuEventQueue[event].data;
+        ApuC3a = ApuRenderEvents[event].data;
         break;
 
       case 1:
-        ApuC3b = ApuEventQueue[event].data;
+        ApuC3b = ApuRenderEvents[event].data;
         break;
 
       case 2:
-        ApuC3c = ApuEventQueue[event].data;
+        ApuC3c = ApuRenderEvents[event].data;
         if (ApuC3Freq)
         {
           ApuC3Skip = ApuTriangleMagic / ApuC3Freq;
@@ -698,7 +855,7 @@ int __not_in_flash_func(ApuWriteWave3)(int cycles, int event)
         break;
 
       case 3:
-        ApuC3d = ApuEventQueue[event].data;
+        ApuC3d = ApuRenderEvents[event].data;
         ApuC3Atl = ApuC3LengthCounter;
         ApuC3ReloadFlag = true;
         if (ApuC3Freq)
@@ -711,11 +868,11 @@ int __not_in_flash_func(ApuWriteWave3)(int cycles, int event)
         }
       }
     }
-    else if (ApuEventQueue[event].type == APUET_W_CTRL)
+    else if (ApuRenderEvents[event].type == APUET_W_CTRL)
     {
-      ApuCtrlNew = ApuEventQueue[event].data;
+      ApuCtrlNew = ApuRenderEvents[event].data;
 
-      if (!(ApuEventQueue[event].data & (1 << 2)))
+      if (!(ApuRenderEvents[event].data & (1 << 2)))
       {
         ApuC3Atl = 0;
         ApuC3Llc = 0;
@@ -730,26 +887,59 @@ int __not_in_flash_func(ApuWriteWave3)(int cycles, int event)
 /* Rendering triangle wave #3                                        */
 /*-------------------------------------------------------------------*/
 
+/* Whether the triangle wave sounds */
+static inline bool ApuC3On()
+{
+  return (ApuCtrlNew & 0x04) && ApuC3Atl > 0 && ApuC3Llc > 0 && ApuC3Freq >= 8;
+}
+
+/* Render the next samples up to a phase edge, returns the count ( 1-max ) */
+static inline int ApuC3Run(int max, int *level)
+{
+  ApuC3Index += ApuC3Skip;
+  ApuC3Index &= 0x1fffffff;
+  *level = triangle_50[ApuC3Index >> 24] >> 4;
+
+  int n = ApuPhaseRun(ApuC3Index, ApuC3Skip, triangle_50, max);
+  ApuC3Index += ApuC3Skip * (n - 1);
+  ApuC3Index &= 0x1fffffff;
+  return n;
+}
+
+#if defined(APU_SPLIT_CHANNELS)
 void __not_in_flash_func(ApuRenderingWave3)(int n)
 {
   ApuCtrlNew = ApuCtrl;
-  ApuWriteWave3(ApuCyclesPerSample * (n + 1), 0);
 
-  if ((ApuCtrlNew & 0x04) && ApuC3Atl > 0 && ApuC3Llc > 0 && ApuC3Freq >= 8)
+  int event = 0;
+  for (int i = 0; i < n;)
   {
-    for (unsigned int i = 0; i < n; i++)
+    /* Apply the writes up to this sample, render until the next one */
+    event = ApuWriteWave3(i + 1, event);
+    int end = ApuNextEventSample(event, n);
+
+    if (ApuC3On())
     {
-      /* Wave Rendering */
-      ApuC3Index += ApuC3Skip;
-      ApuC3Index &= 0x1fffffff;
-      wave_buffers[2][i] = triangle_50[ApuC3Index >> 24];
+      while (i < end)
+      {
+        /* Wave Rendering */
+        int level;
+        int run = ApuC3Run(end - i, &level);
+        memset(&wave_buffers[2][i], level, run);
+        i += run;
+      }
+    }
+    else
+    {
+      memset(&wave_buffers[2][i], 0, end - i);
+      i = end;
     }
   }
-  else
-  {
-    memset(wave_buffers[2], 0, 2 * n);
-  }
+
+  /* Writes after the last rendered sample */
+  ApuWriteWave3(APU_EVENT_TIME_MAX, event);
 }
+#endif
 
 /*===================================================================*/
 /*                                                                   */
@@ -761,25 +951,25 @@ void __not_in_flash_func(ApuRenderingWave3)(int n)
 /* Write registers of noise channel #4                              */
 /*-------------------------------------------------------------------*/
 
-int __not_in_flash_func(ApuWriteWave4)(int cycles, int event)
+int __not_in_flash_func(ApuWriteWave4)(int sample, int event)
 {
   /* APU Reg Write Event */
-  while ((event < cur_event) && (ApuEventQueue[event].time < cycles))
+  while ((event < ApuRenderEventCount) && (ApuRenderEvents[event].time < sample))
   {
-    if ((ApuEventQueue[event].type & APUET_MASK) == APUET_C4)
+    if ((ApuRenderEvents[event].type & APUET_MASK) == APUET_C4)
     {
-      switch (ApuEventQueue[event].type & 3)
+      switch (ApuRenderEvents[event].type & 3)
       {
       case 0:
-        ApuC4a = ApuEventQueue[event].data;
+        ApuC4a = ApuRenderEvents[event].data;
         break;
 
       case 1:
-        ApuC4b = ApuEventQueue[event].data;
+        ApuC4b = ApuRenderEvents[event].data;
         break;
 
       case 2:
-        ApuC4c = ApuEventQueue[event].data;
+        ApuC4c = ApuRenderEvents[event].data;
 
         // if (ApuC4Small)
         // {
@@ -803,7 +993,7 @@ int __not_in_flash_func(ApuWriteWave4)(int cycles, int event)
         break;
 
       case 3:
-        ApuC4d = ApuEventQueue[event].data;
+        ApuC4d = ApuRenderEvents[event].data;
 
         /* Frequency */
         if (ApuC4Freq)
@@ -818,11 +1008,11 @@ int __not_in_flash_func(ApuWriteWave4)(int cycles, int event)
         ApuC4EnvVol = 15;
       }
     }
-    else if (ApuEventQueue[event].type == APUET_W_CTRL)
+    else if (ApuRenderEvents[event].type == APUET_W_CTRL)
     {
-      ApuCtrlNew = ApuEventQueue[event].data;
+      ApuCtrlNew = ApuRenderEvents[event].data;
 
-      if (!(ApuEventQueue[event].data & (1 << 3)))
+      if (!(ApuRenderEvents[event].data & (1 << 3)))
       {
         ApuC4Atl = 0;
       }
@@ -836,48 +1026,101 @@ int __not_in_flash_func(ApuWriteWave4)(int cycles, int event)
 /* Rendering noise channel #4                                        */
 /*-------------------------------------------------------------------*/
 
+/* Volume while the noise channel sounds, -1 when it is silent */
+static inline int ApuC4Level()
+{
+  if ((ApuCtrlNew & 0x08) && ApuC4Atl)
+  {
+    return ApuC4Env ? ApuC4Vol : ApuC4EnvVol;
+  }
+  return -1;
+}
+
+/*
+ *  Clock the shift register `clocks` times. The next 15 - shift feedback
+ *  bits only depend on bits already in the register, so they are made
+ *  in one go: a sample takes one or two steps even at the top rates
+ */
+static inline void ApuC4Clock(int clocks, int shift)
+{
+  int chunk = 15 - shift;
+  DWORD sr = ApuC4Sr;
+  while (clocks > 0)
+  {
+    int k = std::min(clocks, chunk);
+    DWORD f = (sr ^ (sr >> shift)) & ((1 << k) - 1);
+    sr = (sr >> k) | (f << (15 - k));
+    clocks -= k;
+  }
+  ApuC4Sr = sr;
+}
+
+/* DAC level ( 0-15 ) of the next sample */
+static inline int ApuC4Step(int vol, int shift)
+{
+  ApuC4Index += ApuC4Skip;
+  if (ApuC4Index > 0xffffff)
+  {
+    /* Every timer period passed since the last sample clocks it once */
+    ApuC4Clock(ApuC4Index >> 24, shift);
+    ApuC4Index &= 0xffffff;
+  }
+  return (ApuC4Sr & 1) ? 0 : vol;
+}
+
+/* Render the next samples up to a shift register clock, returns the count ( 1-max ) */
+static inline int ApuC4Run(int vol, int shift, int max, int *level, int *edge)
+{
+  DWORD clocks = (ApuC4Index + ApuC4Skip) >> 24;
+  *level = ApuC4Step(vol, shift);
+
+  /* Only a single clock in the step has one edge time */
+  if (edge)
+    *edge = clocks == 1 ? ApuC4Index / (ApuC4Skip / APU_BLEP_PHASES + 1) : -1;
+
+  /* The output holds until the phase passes 0xffffff again */
+  DWORD run = ApuC4Skip ? (0xffffff - ApuC4Index) / ApuC4Skip + 1 : max;
+  int n = run < (DWORD)max ? run : max;
+  ApuC4Index += ApuC4Skip * (n - 1);
+  return n;
+}
+
+#if defined(APU_SPLIT_CHANNELS)
 void __not_in_flash_func(ApuRenderingWave4)(int n)
 {
   ApuCtrlNew = ApuCtrl;
-  ApuWriteWave4(ApuCyclesPerSample * (n + 1), 0);
 
-  if ((ApuCtrlNew & 0x08) && ApuC4Atl)
+  int event = 0;
+  for (int i = 0; i < n;)
   {
-    int shift = ApuC4Small ? 6 : 1;
-    for (unsigned int i = 0; i < n; i++)
-    {
-      /* Wave Rendering */
-      ApuC4Index += ApuC4Skip;
-      if (ApuC4Index > 0xffffff)
-      {
-        int f = (ApuC4Sr ^ (ApuC4Sr >> shift)) & 1;
-        ApuC4Sr = (ApuC4Sr >> 1) | (f << 14);
-
-        ApuC4Index &= 0xffffff;
-      }
+    /* Apply the writes up to this sample, render until the next one */
+    event = ApuWriteWave4(i + 1, event);
+    int end = ApuNextEventSample(event, n);
 
-      if (!(ApuC4Sr & 1))
-      {
-        if (ApuC4Env)
-        {
-          wave_buffers[3][i] = ApuC4Vol;
-        }
-        else
-        {
-          wave_buffers[3][i] = ApuC4EnvVol;
-        }
-      }
-      else
+    int vol = ApuC4Level();
+    if (vol >= 0)
+    {
+      int shift = ApuC4Small ? 6 : 1;
+      while (i < end)
       {
-        wave_buffers[3][i] = 0;
+        /* Wave Rendering */
+        int level;
+        int run = ApuC4Run(vol, shift, end - i, &level, nullptr);
+        memset(&wave_buffers[3][i], level, run);
+        i += run;
       }
     }
+    else
+    {
+      memset(&wave_buffers[3][i], 0, end - i);
+      i = end;
+    }
   }
-  else
-  {
-    memset(wave_buffers[3], 0, n << 1);
-  }
+
+  /* Writes after the last rendered sample */
+  ApuWriteWave4(APU_EVENT_TIME_MAX, event);
 }
+#endif
 
 /*===================================================================*/
 /*                                                                   */
@@ -889,37 +1132,37 @@ void __not_in_flash_func(ApuRenderingWave4)(int n)
 /* Write registers of DPCM channel #5                               */
 /*-------------------------------------------------------------------*/
 
-int __not_in_flash_func(ApuWriteWave5)(int cycles, int event)
+int __not_in_flash_func(ApuWriteWave5)(int sample, int event)
 {
   /* APU Reg Write Event */
-  while ((event < cur_event) && (ApuEventQueue[event].time < cycles))
+  while ((event < ApuRenderEventCount) && (ApuRenderEvents[event].time < sample))
   {
-    if ((ApuEventQueue[event].type & APUET_MASK) == APUET_C5)
+    if ((ApuRenderEvents[event].type & APUET_MASK) == APUET_C5)
     {
-      ApuC5Reg[ApuEventQueue[event].type & 3] = ApuEventQueue[event].data;
+      ApuC5Reg[ApuRenderEvents[event].type & 3] = ApuRenderEvents[event].data;
 
-      switch (ApuEventQueue[event].type & 3)
+      switch (ApuRenderEvents[event].type & 3)
       {
       case 0:
-        ApuC5Freq = ApuDpcmCycles[(ApuEventQueue[event].data & 0x0F)] << 16;
-        ApuC5Looping = ApuEventQueue[event].data & 0x40;
+        ApuC5Freq = ApuDpcmCycles[(ApuRenderEvents[event].data & 0x0F)] << 16;
+        ApuC5Looping = ApuRenderEvents[event].data & 0x40;
         break;
       case 1:
-        ApuC5DpcmValue = (ApuEventQueue[event].data & 0x7F) >> 1;
+        ApuC5DpcmValue = (ApuRenderEvents[event].data & 0x7F) >> 1;
         break;
       case 2:
-        ApuC5CacheAddr = 0xC000 + (WORD)(ApuEventQueue[event].data << 6);
+        ApuC5CacheAddr = 0xC000 + (WORD)(ApuRenderEvents[event].data << 6);
         break;
       case 3:
-        ApuC5CacheDmaLength = ((ApuEventQueue[event].data << 4) + 1) << 3;
+        ApuC5CacheDmaLength = ((ApuRenderEvents[event].data << 4) + 1) << 3;
         break;
       }
     }
-    else if (ApuEventQueue[event].type == APUET_W_CTRL)
+    else if (ApuRenderEvents[event].type == APUET_W_CTRL)
     {
-      ApuCtrlNew = ApuEventQueue[event].data;
+      ApuCtrlNew = ApuRenderEvents[event].data;
 
-      if (!(ApuEventQueue[event].data & (1 << 4)))
+      if (!(ApuRenderEvents[event].data & (1 << 4)))
       {
         ApuC5Enable = 0;
         ApuC5DmaLength = 0;
@@ -931,6 +1174,7 @@ int __not_in_flash_func(ApuWriteWave5)(int cycles, int event)
         {
           ApuC5Address = ApuC5CacheAddr;
           ApuC5DmaLength = ApuC5CacheDmaLength;
+          ApuC5Left = 0;
         }
       }
     }
@@ -943,68 +1187,432 @@ int __not_in_flash_func(ApuWriteWave5)(int cycles, int event)
 /* Rendering DPCM channel #5                                         */
 /*-------------------------------------------------------------------*/
 
+/* Next sample byte, read from the ROM bank without K6502_Read() */
+static inline BYTE ApuC5Fetch()
+{
+  if (!ApuC5Left || *ApuC5Slot != ApuC5Bank)
+  {
+    /* Sample start, bank end or bank switch: resolve the address again.
+       The address wraps from 0xFFFF to 0x8000. */
+    ApuC5Address |= 0x8000;
+    int slot = (ApuC5Address - 0x8000) >> 13;
+    ApuC5Slot = &ROMBANK[slot];
+    ApuC5Bank = ROMBANK[slot];
+    ApuC5Ptr = ApuC5Bank + (ApuC5Address & 0x1fff);
+    ApuC5Left = 0x2000 - (ApuC5Address & 0x1fff);
+  }
+  ApuC5Left--;
+  ApuC5Address++;
+  XIP_READ(ApuC5Ptr);
+  return *ApuC5Ptr++;
+}
+
+/* DAC level ( 0-127 ) of the next sample */
+static inline int ApuC5Step()
+{
+  if (ApuC5DmaLength)
+  {
+    ApuC5Phaseacc -= ApuCycleRate;
+
+    while (ApuC5Phaseacc < 0)
+    {
+      ApuC5Phaseacc += ApuC5Freq;
+      if (!(ApuC5DmaLength & 7))
+      {
+        ApuC5CurByte = ApuC5Fetch();
+      }
+      if (!(--ApuC5DmaLength))
+      {
+        if (ApuC5Looping)
+        {
+          ApuC5Address = ApuC5CacheAddr;
+          ApuC5DmaLength = ApuC5CacheDmaLength;
+          ApuC5Left = 0;
+        }
+        else
+        {
+          ApuC5Enable = 0;
+          break;
+        }
+      }
+
+      // positive delta
+      if (ApuC5CurByte & (1 << ((ApuC5DmaLength & 7) ^ 7)))
+      {
+        if (ApuC5DpcmValue < 0x3F)
+          ApuC5DpcmValue += 1;
+      }
+      else
+      {
+        // negative delta
+        if (ApuC5DpcmValue > 1)
+          ApuC5DpcmValue -= 1;
+      }
+    }
+  }
+  return ApuC5DpcmValue << 1;
+}
+
+/* Render the next samples up to a delta bit, returns the count ( 1-max ) */
+static inline int ApuC5Run(int max, int *level)
+{
+  *level = ApuC5Step();
+  if (!ApuC5DmaLength)
+    return max;
+
+  /* The output holds while the phase accumulator stays positive */
+  int rate = ApuCycleRate;
+  int n = std::min(ApuC5Phaseacc / rate + 1, max);
+  ApuC5Phaseacc -= rate * (n - 1);
+  return n;
+}
+
+#if defined(APU_SPLIT_CHANNELS)
 void __not_in_flash_func(ApuRenderingWave5)(int n)
 {
   ApuCtrlNew = ApuCtrl;
-  ApuWriteWave5(ApuCyclesPerSample * (n + 1), 0);
 
-  if (ApuCtrlNew & 0x10)
+  int event = 0;
+  for (int i = 0; i < n;)
   {
-    for (unsigned int i = 0; i < n; i++)
+    /* Apply the writes up to this sample, render until the next one */
+    event = ApuWriteWave5(i + 1, event);
+    int end = ApuNextEventSample(event, n);
+
+    if (ApuCtrlNew & 0x10)
     {
-      if (ApuC5DmaLength)
+      while (i < end)
       {
-        ApuC5Phaseacc -= ApuCycleRate;
+        /* Wave Rendering */
+        int level;
+        int run = ApuC5Run(end - i, &level);
+        memset(&wave_buffers[4][i], level, run);
+        i += run;
+      }
+    }
+    else
+    {
+      memset(&wave_buffers[4][i], 0, end - i);
+      i = end;
+    }
+  }
+
+  /* Writes after the last rendered sample */
+  ApuWriteWave5(APU_EVENT_TIME_MAX, event);
+}
+#else
+/*===================================================================*/
+/*                                                                   */
+/*     ApuRenderingMixed() : Render and mix all channels at once     */
+/*                                                                   */
+/*===================================================================*/
+
+/* Apply the writes of every channel made before `sample` */
+static inline int ApuWriteWaves(int sample, int event)
+{
+  ApuWriteWave1(sample, event);
+  ApuWriteWave2(sample, event);
+  ApuWriteWave3(sample, event);
+  ApuWriteWave4(sample, event);
+  return ApuWriteWave5(sample, event);
+}
 
-        while (ApuC5Phaseacc < 0)
+int __not_in_flash_func(ApuRenderingMixed)(DWORD *out, int i, int n, int event)
+{
+  /*
+   *  Render samples i to n-1 of the batch and mix them
+   *
+   *  Parameters
+   *    DWORD *out               (Write)
+   *      Stereo output frames, ( right << 16 ) | left
+   *
+   *  Return values
+   *    The first event that has not been applied yet
+   */
+
+  while (i < n)
+  {
+    /* Apply the writes up to this sample, render until the next one */
+    event = ApuWriteWaves(i + 1, event);
+    int end = ApuNextEventSample(event, n);
+
+    int vol1 = ApuC1Level();
+    int vol2 = ApuC2Level();
+    bool on3 = ApuC3On();
+    int vol4 = ApuC4Level();
+    bool on5 = ApuCtrlNew & 0x10;
+    int shift4 = ApuC4Small ? 6 : 1;
+
+    /* Each channel holds its level for runN samples, silent ones all along */
+    int p1 = 0, p2 = 0, t = 0, ns = 0, d = 0;
+    int run1 = 0, run2 = 0, run3 = 0, run4 = 0, run5 = 0;
+    while (i < end)
+    {
+      int max = end - i;
+      if (!run1)
+        run1 = vol1 >= 0 ? ApuC1Run(vol1, max, &p1) : max;
+      if (!run2)
+        run2 = vol2 >= 0 ? ApuC2Run(vol2, max, &p2) : max;
+      if (!run3)
+        run3 = on3 ? ApuC3Run(max, &t) : max;
+      if (!run4)
+        run4 = vol4 >= 0 ? ApuC4Run(vol4, shift4, max, &ns, nullptr) : max;
+      if (!run5)
+        run5 = on5 ? ApuC5Run(max, &d) : max;
+
+      /* Fill up to the first edge of any channel with one mixed value */
+      int run = std::min(std::min(std::min(run1, run2), std::min(run3, run4)), run5);
+      DWORD v = SoundPulseMix[p1 * 16 + p2] + SoundTndMix[3 * t + 2 * ns + d];
+      for (int j = 0; j < run; j++)
+        *out++ = v;
+
+      i += run;
+      run1 -= run;
+      run2 -= run;
+      run3 -= run;
+      run4 -= run;
+      run5 -= run;
+    }
+  }
+  return event;
+}
+
+/*===================================================================*/
+/*                                                                   */
+/*   ApuRenderingBlep() : Render with band-limited steps ( BLEP )    */
+/*                                                                   */
+/*===================================================================*/
+
+/* Step kernel per sub-sample phase ( 4.12 fixed point, sums to 4096 ) */
+static short ApuBlepKernel[APU_BLEP_PHASES][APU_BLEP_TAPS];
+
+/* Pending output changes ( left, right ) of the batch and the kernel tail */
+static int ApuBlepDelta[APU_BLEP_BUFFER_SIZE + APU_BLEP_TAPS][2];
+static int ApuBlepSum[2];
+
+/* Channel levels, and their mixed value, the deltas have reached */
+static int ApuBlepLevels[5];
+static DWORD ApuBlepLevel;
+
+/* Blackman-windowed sinc cut at 0.45 fs, x in samples */
+static float ApuBlepImpulse(float x)
+{
+  const int half = APU_BLEP_TAPS / 2;
+  const float cutoff = 0.9f;
+  const float pi = 3.14159265f;
+
+  if (x <= -half || x >= half)
+    return 0.0f;
+  float s = x ? sinf(pi * cutoff * x) / (pi * x) : cutoff;
+  float w = 0.42f + 0.5f * cosf(pi * x / half) + 0.08f * cosf(2 * pi * x / half);
+  return s * w;
+}
+
+void ApuBlepInit()
+{
+  /*
+   *  Build the step kernels
+   *
+   *  Remarks
+   *    The impulse is integrated on a grid of half phases into the step
+   *    response g(). The kernel of phase p is g() at the taps, for an
+   *    edge ( p + 0.5 ) / APU_BLEP_PHASES of a sample before the first
+   *    one, differentiated per tap. A first pass finds the full area.
+   */
+
+  const int half = APU_BLEP_TAPS / 2;
+  const int steps = 2 * APU_BLEP_PHASES;
+  const int points = (APU_BLEP_TAPS + 1) * steps;
+
+  float area = 0.0f;
+  for (int pass = 0; pass < 2; pass++)
+  {
+    float g = 0.0f;
+    float prev = 0.0f;
+    int last[APU_BLEP_PHASES] = {0};
+    for (int m = 1; m <= points; m++)
+    {
+      float h = ApuBlepImpulse((float)m / steps - half - 1);
+      g += (prev + h) * 0.5f / steps;
+      prev = h;
+
+      /* Grid point m is g( j - half + f ) of tap j, phase p */
+      int j = (m - 1) / steps - 1;
+      int p = (m - 1) % steps;
+      if (pass && j >= 0 && j < APU_BLEP_TAPS && !(p & 1))
+      {
+        p >>= 1;
+        int level = j < APU_BLEP_TAPS - 1 ? (int)(4096.0f * g / area + 0.5f) : 4096;
+        ApuBlepKernel[p][j] = level - last[p];
+        last[p] = level;
+      }
+    }
+    area = g;
+  }
+
+  memset(ApuBlepDelta, 0, sizeof ApuBlepDelta);
+  memset(ApuBlepLevels, 0, sizeof ApuBlepLevels);
+  ApuBlepSum[0] = ApuBlepSum[1] = 0;
+  ApuBlepLevel = 0;
+}
+
+/* Move the output to the mix of ApuBlepLevels, an edge before sample i */
+static inline void ApuBlepStep(int i, int edge)
+{
+  DWORD to = SoundPulseMix[ApuBlepLevels[0] * 16 + ApuBlepLevels[1]] +
+             SoundTndMix[3 * ApuBlepLevels[2] + 2 * ApuBlepLevels[3] + ApuBlepLevels[4]];
+  if (to == ApuBlepLevel)
+    return;
+
+  int dl = (int)(to & 0xffff) - (int)(ApuBlepLevel & 0xffff);
+  int dr = (int)(to >> 16) - (int)(ApuBlepLevel >> 16);
+  ApuBlepLevel = to;
+
+  int(*d)[2] = &ApuBlepDelta[i];
+  if (edge < 0)
+  {
+    /* No edge time ( register writes, fast noise ): a plain step */
+    d[APU_BLEP_TAPS / 2][0] += dl * 4096;
+    d[APU_BLEP_TAPS / 2][1] += dr * 4096;
+    return;
+  }
+
+  const short *k = ApuBlepKernel[edge];
+  for (int j = 0; j < APU_BLEP_TAPS; j++)
+  {
+    d[j][0] += dl * k[j];
+    d[j][1] += dr * k[j];
+  }
+}
+
+/* One step per wave edge ( in 1/32 periods ) crossed on the way to sample i */
+static inline void ApuBlepPhaseSteps(int i, int c, DWORD before, DWORD skip,
+                                     const BYTE *wave, int vol)
+{
+  DWORD after = before + skip;
+  DWORD phaseSize = skip / APU_BLEP_PHASES + 1;
+  for (DWORD m = (before >> 24) + 1; m <= (after >> 24); m++)
+  {
+    int level = (wave[m & 31] >> 4) * vol;
+    if (level != ApuBlepLevels[c])
+    {
+      ApuBlepLevels[c] = level;
+      ApuBlepStep(i, (after - (m << 24)) / phaseSize);
+    }
+  }
+}
+
+int __not_in_flash_func(ApuRenderingBlep)(int n, int event)
+{
+  /*
+   *  Render samples 0 to n-1 of the batch into ApuBlepDelta
+   *
+   *  Remarks
+   *    The runs of ApuRenderingMixed, only the level changes at their
+   *    starts cost anything. Each channel's change is placed at its
+   *    own edge time.
+   *
+   *  Return values
+   *    The first event that has not been applied yet
+   */
+
+  for (int i = 0; i < n;)
+  {
+    /* Apply the writes up to this sample, render until the next one */
+    event = ApuWriteWaves(i + 1, event);
+    int end = ApuNextEventSample(event, n);
+
+    int vol1 = ApuC1Level();
+    int vol2 = ApuC2Level();
+    bool on3 = ApuC3On();
+    int vol4 = ApuC4Level();
+    bool on5 = ApuCtrlNew & 0x10;
+    int shift4 = ApuC4Small ? 6 : 1;
+
+    int run[5] = {0, 0, 0, 0, 0};
+    while (i < end)
+    {
+      int max = end - i;
+      int level[5];
+      int edge[5] = {-1, -1, -1, -1, -1};
+      memcpy(level, ApuBlepLevels, sizeof level);
+
+      /* Pulse and triangle place every edge the first step passes */
+      if (!run[0])
+      {
+        DWORD before = ApuC1Index;
+        run[0] = vol1 >= 0 ? ApuC1Run(vol1, max, &level[0]) : (level[0] = 0, max);
+        if (vol1 > 0)
+          ApuBlepPhaseSteps(i, 0, before, ApuC1Skip, ApuC1Wave, vol1);
+      }
+      if (!run[1])
+      {
+        DWORD before = ApuC2Index;
+        run[1] = vol2 >= 0 ? ApuC2Run(vol2, max, &level[1]) : (level[1] = 0, max);
+        if (vol2 > 0)
+          ApuBlepPhaseSteps(i, 1, before, ApuC2Skip, ApuC2Wave, vol2);
+      }
+      if (!run[2])
+      {
+        DWORD before = ApuC3Index;
+        run[2] = on3 ? ApuC3Run(max, &level[2]) : (level[2] = 0, max);
+        if (on3)
+          ApuBlepPhaseSteps(i, 2, before, ApuC3Skip, triangle_50, 1);
+      }
+      if (!run[3])
+        run[3] = vol4 >= 0 ? ApuC4Run(vol4, shift4, max, &level[3], &edge[3]) : (level[3] = 0, max);
+      if (!run[4])
+        run[4] = on5 ? ApuC5Run(max, &level[4]) : (level[4] = 0, max);
+
+      int len = max;
+      for (int c = 0; c < 5; c++)
+      {
+        if (level[c] != ApuBlepLevels[c])
         {
-          ApuC5Phaseacc += ApuC5Freq;
-          if (!(ApuC5DmaLength & 7))
-          {
-            ApuC5CurByte = K6502_Read(ApuC5Address);
-            if (0xFFFF == ApuC5Address)
-              ApuC5Address = 0x8000;
-            else
-              ApuC5Address++;
-          }
-          if (!(--ApuC5DmaLength))
-          {
-            if (ApuC5Looping)
-            {
-              ApuC5Address = ApuC5CacheAddr;
-              ApuC5DmaLength = ApuC5CacheDmaLength;
-            }
-            else
-            {
-              ApuC5Enable = 0;
-              break;
-            }
-          }
-
-          // positive delta
-          if (ApuC5CurByte & (1 << ((ApuC5DmaLength & 7) ^ 7)))
-          {
-            if (ApuC5DpcmValue < 0x3F)
-              ApuC5DpcmValue += 1;
-          }
-          else
-          {
-            // negative delta
-            if (ApuC5DpcmValue > 1)
-              ApuC5DpcmValue -= 1;
-          }
+          ApuBlepLevels[c] = level[c];
+          ApuBlepStep(i, edge[c]);
         }
+        len = std::min(len, run[c]);
       }
 
-      /* Wave Rendering */
-      wave_buffers[4][i] = ApuC5DpcmValue;
+      i += len;
+      for (int c = 0; c < 5; c++)
+        run[c] -= len;
     }
   }
-  else
+  return event;
+}
+
+/* Silence from sample 0 of the batch on */
+void ApuBlepMute()
+{
+  memset(ApuBlepLevels, 0, sizeof ApuBlepLevels);
+  ApuBlepStep(0, -1);
+}
+
+/* Integrate samples i to i+count-1 of the batch, out may be NULL */
+void __not_in_flash_func(ApuBlepRead)(DWORD *out, int i, int count)
+{
+  int l = ApuBlepSum[0];
+  int r = ApuBlepSum[1];
+  for (int j = i; j < i + count; j++)
   {
-    memset(wave_buffers[4], 0, n << 1);
+    l += ApuBlepDelta[j][0];
+    r += ApuBlepDelta[j][1];
+    if (out)
+      *out++ = (DWORD)(((l + 2048) >> 12) & 0xffff) | ((DWORD)(((r + 2048) >> 12) & 0xffff) << 16);
   }
+  ApuBlepSum[0] = l;
+  ApuBlepSum[1] = r;
+}
+
+/* Drop a read batch of n samples, keep the kernel tails behind it */
+void ApuBlepNext(int n)
+{
+  memmove(&ApuBlepDelta[0], &ApuBlepDelta[n], sizeof ApuBlepDelta[0] * APU_BLEP_TAPS);
+  memset(&ApuBlepDelta[APU_BLEP_TAPS], 0, sizeof ApuBlepDelta[0] * n);
 }
+#endif
 
 /*===================================================================*/
 /*                                                                   */
@@ -1012,7 +1620,39 @@ void __not_in_flash_func(ApuRenderingWave5)(int n)
 /*                                                                   */
 /*===================================================================*/
 
+static void ApuFlush(bool vsync);
+static void ApuFrameStep();
+#if defined(APU_CORE1)
+static void ApuStatusFrameStep();
+#endif
+
 void InfoNES_pAPUVsync()
+{
+  /* Render up to here with the state before the frame counter step */
+#if defined(APU_CORE1)
+  ApuFlush(true);
+  ApuStatusFrameStep();
+#else
+  ApuFlush(false);
+#endif
+
+  if (ApuQualityNext != ApuQuality)
+  {
+    ApuSetQuality(ApuQualityNext);
+  }
+
+  /* Stretch the next frame by the trim the sound driver asks for, the
+     pitch is kept, only the number of samples per line changes */
+  unsigned int base = ApuQual[ApuQuality].samples_per_sync_16;
+  ApuSamplesPerSync16 = base + (int)base * InfoNES_SoundRateTrim() / 65536;
+
+#if !defined(APU_CORE1)
+  ApuFrameStep();
+#endif
+}
+
+/* Length counters, envelopes and sweeps, once per frame */
+static void __not_in_flash_func(ApuFrameStep)()
 {
   if (ApuC1Atl)
   {
@@ -1157,17 +1797,45 @@ void InfoNES_pAPUVsync()
 /*                                                                   */
 /*===================================================================*/
 
-uint32_t leftSamples16 = 0;
+uint32_t ApuPendingSamples16 = 0; /* Samples owed since the last flush ( 16.16 ) */
+int ApuPendingLines = 0;
+WORD ApuLineClocks;              /* CPU clock at the last Hsync */
+bool ApuEnabled = true;
 
 void __not_in_flash_func(InfoNES_pAPUHsync)(bool enabled)
 {
-  auto n16 = ApuSamplesPerSync16 + leftSamples16;
-  auto n = n16 >> 16;
-  leftSamples16 = n16 - (n << 16);
+  ApuEnabled = enabled;
+  ApuLineClocks = getPassedClocks();
+  ApuPendingSamples16 += ApuSamplesPerSync16;
 
-  int bufferLeft = InfoNES_GetSoundBufferSize();
-  n = std::min<int>(bufferLeft, n);
+  if (++ApuPendingLines >= APU_BATCH_LINES ||
+      (ApuPendingSamples16 >> 16) + 3 > APU_WAVE_BUFFER_SIZE)
+  {
+    InfoNES_pAPUFlush();
+  }
+}
+
+/*===================================================================*/
+/*                                                                   */
+/*     InfoNES_pApuFlush() : Render the samples owed so far          */
+/*                                                                   */
+/*===================================================================*/
 
+static void __not_in_flash_func(ApuRenderBatch)(const struct ApuEvent_t *events, int count,
+                                                 int n, bool enabled)
+{
+  /*
+   *  Render n samples, replaying the writes at their sample
+   *
+   *  Remarks
+   *    With APU_CORE1 this runs on the other core, and the channel
+   *    state it touches belongs to that core.
+   */
+
+  ApuRenderEvents = events;
+  ApuRenderEventCount = count;
+
+#if defined(APU_SPLIT_CHANNELS)
   if (enabled)
   {
     ApuRenderingWave1(n);
@@ -1189,23 +1857,312 @@ void __not_in_flash_func(InfoNES_pAPUHsync)(bool enabled)
   InfoNES_SoundOutput(n,
                       wave_buffers[0], wave_buffers[1], wave_buffers[2],
                       wave_buffers[3], wave_buffers[4]);
+#else
+  ApuCtrlNew = ApuCtrl;
+  int event = 0;
+  if (ApuBlep)
+  {
+    /* Render the batch as deltas, integrate them into the ring below */
+    n = std::min<int>(n, APU_BLEP_BUFFER_SIZE);
+    if (enabled)
+    {
+      event = ApuRenderingBlep(n, event);
+    }
+    else
+    {
+      ApuBlepMute();
+    }
+  }
+
+  /* Render straight into the output ring, it may wrap once */
+  int i = 0;
+  while (i < n)
+  {
+    int locked;
+    DWORD *out = InfoNES_SoundLockBuffer(n - i, &locked);
+    if (!locked)
+      break;
 
-  entertime = getPassedClocks();
+    if (ApuBlep)
+    {
+      ApuBlepRead(out, i, locked);
+    }
+    else if (enabled)
+    {
+      event = ApuRenderingMixed(out, i, i + locked, event);
+    }
+    else
+    {
+      memset(out, 0, locked * sizeof(DWORD));
+    }
+    InfoNES_SoundUnlockBuffer(locked);
+    i += locked;
+  }
+  if (ApuBlep)
+  {
+    /* Samples the ring had no room for still move the integrators */
+    ApuBlepRead(NULL, i, n - i);
+    ApuBlepNext(n);
+  }
+  if (enabled)
+  {
+    /* Writes after the last rendered sample */
+    ApuWriteWaves(APU_EVENT_TIME_MAX, event);
+    ApuCtrl = ApuCtrlNew;
+  }
+#endif
+}
+
+void __not_in_flash_func(InfoNES_pAPUFlush)()
+{
+  ApuFlush(false);
+}
+
+static void __not_in_flash_func(ApuFlush)(bool vsync)
+{
+  /*
+   *  Render the samples of the scanlines since the last flush
+   *
+   *  Remarks
+   *    Register writes were queued with their CPU clock relative to
+   *    entertime, they are replayed at the matching sample. Writes
+   *    made after the last Hsync are applied at the end of the batch.
+   *    With APU_CORE1 the batch is handed to the other core instead.
+   */
+
+  auto n = ApuPendingSamples16 >> 16;
+  ApuPendingSamples16 -= n << 16;
+  ApuPendingLines = 0;
+
+  /* CPU clocks since entertime -> sample index */
+  for (int event = 0; event < cur_event; ++event)
+  {
+    DWORD clocks = (WORD)ApuEventQueue[event].time;
+    ApuEventQueue[event].time = std::min<DWORD>((clocks << 16) / ApuCycleRate, APU_EVENT_TIME_MAX);
+  }
+
+#if defined(APU_CORE1)
+  DWORD head = ApuBatchHead.load(std::memory_order_relaxed);
+  struct ApuBatch_t *batch = &ApuBatches[head % APU_CORE1_BATCHES];
+  batch->count = cur_event;
+  batch->samples = n;
+  batch->enabled = ApuEnabled;
+  batch->vsync = vsync;
+  ApuBatchHead.store(++head, std::memory_order_release);
+  __sev();
+
+  /* The next writes go into the next batch, wait until it is free */
+  while (head - ApuBatchTail.load(std::memory_order_acquire) >= APU_CORE1_BATCHES)
+  {
+    __wfe();
+  }
+  ApuEventQueue = ApuBatches[head % APU_CORE1_BATCHES].events;
+#else
+  ApuRenderBatch(ApuEventQueue, cur_event, n, ApuEnabled);
+#endif
+
+  entertime = ApuLineClocks;
   cur_event = 0;
 }
 
+#if defined(APU_CORE1)
+/*===================================================================*/
+/*                                                                   */
+/*     InfoNES_pAPUService() : Render the published batches          */
+/*                                                                   */
+/*===================================================================*/
+
+bool __not_in_flash_func(InfoNES_pAPUService)()
+{
+  /*
+   *  Render the next batch the CPU core has published ( other core )
+   *
+   *  Return values
+   *    false : Nothing was published
+   */
+
+  DWORD tail = ApuBatchTail.load(std::memory_order_relaxed);
+  if (tail == ApuBatchHead.load(std::memory_order_acquire))
+    return false;
+
+  const struct ApuBatch_t *batch = &ApuBatches[tail % APU_CORE1_BATCHES];
+  ApuRenderBatch(batch->events, batch->count, batch->samples, batch->enabled);
+  if (batch->vsync)
+    ApuFrameStep();
+
+  ApuBatchTail.store(tail + 1, std::memory_order_release);
+  __sev();
+  return true;
+}
+
+void __not_in_flash_func(InfoNES_pAPUDrain)()
+{
+  /* Wait until the other core has rendered every published batch */
+  while (ApuBatchTail.load(std::memory_order_acquire) != ApuBatchHead.load(std::memory_order_relaxed))
+  {
+    __wfe();
+  }
+}
+
+/*-------------------------------------------------------------------*/
+/*  Length counters for $4015 reads, kept on the CPU core            */
+/*  The same steps as ApuWriteWave1-4 and ApuFrameStep, so a read    */
+/*  never waits for the other core.                                  */
+/*-------------------------------------------------------------------*/
+static BYTE ApuStatusC1d, ApuStatusC2d, ApuStatusC3a, ApuStatusC4a, ApuStatusC4d;
+static BYTE ApuStatusAtl[4];
+static DWORD ApuStatusC3Llc;
+static bool ApuStatusC3Reload;
+
+static void __not_in_flash_func(ApuStatusWrite)(BYTE type, BYTE data)
+{
+  switch (type)
+  {
+  case APUET_W_C1D:
+    ApuStatusC1d = data;
+    /* Fall through */
+  case APUET_W_C1C:
+    ApuStatusAtl[0] = ApuAtl[(ApuStatusC1d & 0xf8) >> 3];
+    break;
+
+  case APUET_W_C2D:
+    ApuStatusC2d = data;
+    /* Fall through */
+  case APUET_W_C2C:
+    ApuStatusAtl[1] = ApuAtl[(ApuStatusC2d & 0xf8) >> 3];
+    break;
+
+  case APUET_W_C3A:
+    ApuStatusC3a = data;
+    break;
+
+  case APUET_W_C3D:
+    ApuStatusAtl[2] = ApuAtl[(data & 0xf8) >> 3];
+    ApuStatusC3Reload = true;
+    break;
+
+  case APUET_W_C4A:
+    ApuStatusC4a = data;
+    break;
+
+  case APUET_W_C4D:
+    ApuStatusC4d = data;
+    /* Fall through */
+  case APUET_W_C4C:
+    ApuStatusAtl[3] = ApuAtl[ApuStatusC4d >> 3] << 1;
+    break;
+
+  case APUET_W_CTRL:
+    for (int ch = 0; ch < 4; ++ch)
+    {
+      if (!(data & (1 << ch)))
+        ApuStatusAtl[ch] = 0;
+    }
+    if (!(data & (1 << 2)))
+      ApuStatusC3Llc = 0;
+    break;
+  }
+}
+
+static void ApuStatusFrameStep()
+{
+  if (ApuStatusAtl[0])
+    ApuStatusAtl[0]--;
+  if (ApuStatusAtl[1])
+    ApuStatusAtl[1]--;
+
+  if (ApuStatusC3Reload)
+    ApuStatusC3Llc = ((WORD)ApuStatusC3a & 0x7f) << 6;
+  else if (ApuStatusC3Llc > 0)
+    ApuStatusC3Llc = std::max<int>(0, (int)ApuStatusC3Llc - 4 * 64);
+  if (!(ApuStatusC3a & 0x80))
+    ApuStatusC3Reload = false;
+  if (ApuStatusAtl[2] > 0 && !(ApuStatusC3a & 0x80))
+    ApuStatusAtl[2]--;
+
+  if (ApuStatusAtl[3] && !(ApuStatusC4a & 0x20))
+    ApuStatusAtl[3]--;
+}
+#endif
+
+/*===================================================================*/
+/*                                                                   */
+/*     InfoNES_pAPUReadStatus() : Channel bits of a $4015 read       */
+/*                                                                   */
+/*===================================================================*/
+
+BYTE __not_in_flash_func(InfoNES_pAPUReadStatus)()
+{
+#if defined(APU_CORE1)
+  const BYTE *atl = ApuStatusAtl;
+  bool holdnote = ApuStatusC3a & 0x80;
+  DWORD llc = ApuStatusC3Llc;
+#else
+  // Apply the queued writes so that the length counters are current
+  if (cur_event)
+    InfoNES_pAPUFlush();
+
+  const BYTE atl[4] = {ApuC1Atl, ApuC2Atl, ApuC3Atl, ApuC4Atl};
+  bool holdnote = ApuC3Holdnote;
+  DWORD llc = ApuC3Llc;
+#endif
+
+  BYTE byRet = 0;
+  if (atl[0] > 0)
+    byRet |= (1 << 0);
+  if (atl[1] > 0)
+    byRet |= (1 << 1);
+  if (!holdnote)
+  {
+    if (atl[2] > 0)
+      byRet |= (1 << 2);
+  }
+  else
+  {
+    if (llc > 0)
+      byRet |= (1 << 2);
+  }
+  if (atl[3] > 0)
+    byRet |= (1 << 3);
+  return byRet;
+}
+
 /*===================================================================*/
 /*                                                                   */
 /*            InfoNES_pApuInit() : Initialize pApu                   */
 /*                                                                   */
 /*===================================================================*/
 
-void InfoNES_pAPUInit(void)
+void InfoNES_pAPUSetQuality(int quality)
 {
-  /* Sound Hardware Init */
-  InfoNES_SoundInit();
+  /* Taken over at the next Vsync, the frame so far keeps its rate */
+  if (quality >= 0 && quality < (int)(sizeof ApuQual / sizeof ApuQual[0]))
+  {
+    ApuQualityNext = quality;
+  }
+}
+
+int InfoNES_pAPUGetQuality(void)
+{
+  return ApuQualityNext;
+}
+
+static void ApuSetQuality(int quality)
+{
+  /*
+   *  Switch the sample rate
+   *
+   *  Remarks
+   *    The phase increments of the running channels are derived again
+   *    from their periods, so a tone keeps its pitch across the switch.
+   */
 
-  ApuQuality = pAPU_QUALITY - 1; // 1: 22050, 2: 44100 [samples/sec]
+#if defined(APU_CORE1)
+  /* The channel state belongs to the other core while it renders */
+  InfoNES_pAPUDrain();
+#endif
+
+  ApuQuality = quality; // 0: off, 1: 11025, 2: 22050, 3: 44100 [samples/sec], 4-5: BLEP
 
   ApuPulseMagic = ApuQual[ApuQuality].pulse_magic;
   ApuTriangleMagic = ApuQual[ApuQuality].triangle_magic;
@@ -1214,8 +2171,29 @@ void InfoNES_pAPUInit(void)
   ApuCyclesPerSample = ApuQual[ApuQuality].cycles_per_sample;
   ApuSampleRate = ApuQual[ApuQuality].sample_rate;
   ApuCycleRate = ApuQual[ApuQuality].cycle_rate;
+#if defined(APU_SPLIT_CHANNELS)
+  ApuBlep = false;
+#else
+  ApuBlep = ApuQual[ApuQuality].blep;
+  ApuBlepInit();
+#endif
+
+  ApuC1Skip = ApuC1Freq / 2 ? ApuPulseMagic / (ApuC1Freq / 2) : 0;
+  ApuC2Skip = ApuC2Freq / 2 ? ApuPulseMagic / (ApuC2Freq / 2) : 0;
+  ApuC3Skip = ApuC3Freq ? ApuTriangleMagic / ApuC3Freq : 0;
+  ApuC4Skip = ApuC4Freq ? ApuNoiseMagic / ApuC4Freq : 0;
+  ApuPendingSamples16 = 0;
 
+  InfoNES_SoundClose();
   InfoNES_SoundOpen((ApuSamplesPerSync16 + 65535) >> 16, ApuSampleRate);
+}
+
+void InfoNES_pAPUInit(void)
+{
+  /* Sound Hardware Init */
+  InfoNES_SoundInit();
+
+  ApuSetQuality(ApuQualityNext);
 
   /*-------------------------------------------------------------------*/
   /* Initialize Rectangular, Noise Wave's Regs                         */
@@ -1253,20 +2231,32 @@ void InfoNES_pAPUInit(void)
   ApuC5Reg[0] = ApuC5Reg[1] = ApuC5Reg[2] = ApuC5Reg[3] = 0;
   ApuC5Enable = ApuC5Looping = ApuC5CurByte = ApuC5DpcmValue = 0;
   ApuC5Freq = ApuC5Phaseacc;
-  ApuC5Address = ApuC5CacheAddr = 0;
+  ApuC5Address = ApuC5CacheAddr = 0xC000; /* $4012 = 0 */
+  ApuC5Left = 0;
   ApuC5DmaLength = ApuC5CacheDmaLength = 0;
 
   /*-------------------------------------------------------------------*/
   /*   Initialize Wave Buffers                                         */
   /*-------------------------------------------------------------------*/
-  InfoNES_MemorySet((void *)wave_buffers[0], 0, 735);
-  InfoNES_MemorySet((void *)wave_buffers[1], 0, 735);
-  InfoNES_MemorySet((void *)wave_buffers[2], 0, 735);
-  InfoNES_MemorySet((void *)wave_buffers[3], 0, 735);
-  InfoNES_MemorySet((void *)wave_buffers[4], 0, 735);
-
-  entertime = getPassedClocks();
+#if defined(APU_SPLIT_CHANNELS)
+  InfoNES_MemorySet((void *)wave_buffers[0], 0, APU_WAVE_BUFFER_SIZE);
+  InfoNES_MemorySet((void *)wave_buffers[1], 0, APU_WAVE_BUFFER_SIZE);
+  InfoNES_MemorySet((void *)wave_buffers[2], 0, APU_WAVE_BUFFER_SIZE);
+  InfoNES_MemorySet((void *)wave_buffers[3], 0, APU_WAVE_BUFFER_SIZE);
+  InfoNES_MemorySet((void *)wave_buffers[4], 0, APU_WAVE_BUFFER_SIZE);
+#endif
+
+  entertime = ApuLineClocks = getPassedClocks();
   cur_event = 0;
+  ApuPendingSamples16 = 0;
+  ApuPendingLines = 0;
+
+#if defined(APU_CORE1)
+  ApuStatusC1d = ApuStatusC2d = ApuStatusC3a = ApuStatusC4a = ApuStatusC4d = 0;
+  ApuStatusAtl[0] = ApuStatusAtl[1] = ApuStatusAtl[2] = ApuStatusAtl[3] = 0;
+  ApuStatusC3Llc = 0;
+  ApuStatusC3Reload = false;
+#endif
 }
 
 /*===================================================================*/
@@ -1277,6 +2267,9 @@ void InfoNES_pAPUInit(void)
 
 void InfoNES_pAPUDone(void)
 {
+#if defined(APU_CORE1)
+  InfoNES_pAPUDrain();
+#endif
   InfoNES_SoundClose();
 }
 
@@ -103,6 +103,37 @@
 //#define APU_EVENT_MAX 15000
 #define APU_EVENT_MAX 100
 
+/* Largest event time, used to apply every remaining event */
+#define APU_EVENT_TIME_MAX 0x7fff
+
+/*-------------------------------------------------------------------*/
+/*  pAPU batching                                                    */
+/*  Samples are rendered every APU_BATCH_LINES scanlines ( and at    */
+/*  V-Sync ) instead of every scanline, register writes are replayed */
+/*  at their sample position.                                        */
+/*-------------------------------------------------------------------*/
+#define APU_WAVE_BUFFER_SIZE 735 /* 44100 / 60 */
+#ifndef APU_BATCH_LINES
+#define APU_BATCH_LINES 66
+#endif
+
+/* Batches in flight to the other core with APU_CORE1, one is being filled */
+#ifndef APU_CORE1_BATCHES
+#define APU_CORE1_BATCHES 4
+#endif
+
+/*-------------------------------------------------------------------*/
+/*  Band-limited steps ( BLEP )                                      */
+/*  Level changes are spread over APU_BLEP_TAPS samples by a         */
+/*  windowed-sinc step picked by the sub-sample phase of the edge.   */
+/*  The output is band-limited at the render rate only. Stretching   */
+/*  it to a 44100 Hz stream adds the images of that stretch.         */
+/*-------------------------------------------------------------------*/
+#define APU_BLEP_PHASES 32
+#define APU_BLEP_TAPS 16
+/* BLEP only runs at 22050 Hz or below, half a frame of 44100 Hz */
+#define APU_BLEP_BUFFER_SIZE (APU_WAVE_BUFFER_SIZE / 2 + 1)
+
 struct ApuEvent_t
 {
   short time;
@@ -155,6 +186,25 @@ void InfoNES_pAPUInit(void);
 void InfoNES_pAPUDone(void);
 void InfoNES_pAPUVsync(void);
 void InfoNES_pAPUHsync(bool enabled);
+void InfoNES_pAPUFlush(void);
+
+/* Channel bits ( 0-3 ) of a $4015 read */
+BYTE InfoNES_pAPUReadStatus(void);
+
+#if defined(APU_CORE1)
+/* Render the next published batch on the other core, false if there is none */
+bool InfoNES_pAPUService(void);
+
+/* Wait until the other core has rendered every published batch */
+void InfoNES_pAPUDrain(void);
+#endif
+
+/* Select the sound quality at runtime, taken over at the next Vsync */
+void InfoNES_pAPUSetQuality(int quality);
+int InfoNES_pAPUGetQuality(void);
+
+/* Number of queued register writes */
+extern int cur_event;
 
 /*-------------------------------------------------------------------*/
 /*  pAPU Quality resources                                           */
@@ -162,13 +212,20 @@ void InfoNES_pAPUHsync(bool enabled);
 
 /*-------------------------------------------------------------------*/
 /* ApuQuality is used to control the sound playback rate.            */
+/* 0 turns synthesis off, register writes are still tracked.         */
 /* 1 is 11015 Hz.                                                    */
 /* 2 is 22050 Hz.                                                    */
 /* 3 is 44100 Hz.                                                    */
+/* 4 is 11025 Hz with band-limited steps.                            */
+/* 5 is 22050 Hz with band-limited steps.                            */
 /* these values subject to change without notice.                    */
 /*-------------------------------------------------------------------*/
 extern int ApuQuality;
+extern bool ApuBlep;
+#ifndef pAPU_QUALITY
 #define pAPU_QUALITY 3
+#endif
+#define pAPU_QUALITY_MAX 5
 
 /*-------------------------------------------------------------------*/
 /*  Rectangle Wave #1 resources                                      */
@@ -196,6 +253,12 @@ extern DWORD ApuC3Llc; /* Linear Length Counter */
 
 extern BYTE ApuC4Atl;
 
+/*-------------------------------------------------------------------*/
+/*  DPCM resources                                                   */
+/*-------------------------------------------------------------------*/
+
+extern BYTE *ApuC5Bank; /* ROM bank the samples are streamed from */
+
 #endif /* InfoNES_PAPU_H_INCLUDED */
 
 /*
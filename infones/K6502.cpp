@@ -222,33 +222,27 @@
 /*  Global valiables                                                 */
 /*-------------------------------------------------------------------*/
 
-// 6502 Register
-WORD PC;
-BYTE SP;
-BYTE F;
-BYTE A;
-BYTE X;
-BYTE Y;
-
-// The state of the IRQ pin
-BYTE IRQ_State;
-
-// Wiring of the IRQ pin
-BYTE IRQ_Wiring;
-
-// The state of the NMI pin
-BYTE NMI_State;
-
-// Wiring of the NMI pin
-BYTE NMI_Wiring;
-
-// The number of the clocks that it passed
-int g_wPassedClocks;
-int g_wCurrentClocks;
+// 6502 Register, pins and clocks ( see K6502.h )
+__core0_state("k6502_state") struct K6502_State_tag K6502_State;
+
+#define PC (K6502_State.PC)
+#define SP (K6502_State.SP)
+#define F (K6502_State.F)
+#define A (K6502_State.A)
+#define X (K6502_State.X)
+#define Y (K6502_State.Y)
+#define IRQ_Wiring (K6502_State.IRQ_Wiring)
+#define NMI_Wiring (K6502_State.NMI_Wiring)
+#define IRQ_State (K6502_State.IRQ_State)
+#define NMI_State (K6502_State.NMI_State)
+#define g_wPassedClocks (K6502_State.g_wPassedClocks)
+#define g_wCurrentClocks (K6502_State.g_wCurrentClocks)
+#define g_wSyncedClocks (K6502_State.g_wSyncedClocks)
 
 WORD getPassedClocks()
 {
-  return g_wCurrentClocks;
+  // Exact inside step() too, so that APU writes get their own timestamp
+  return g_wCurrentClocks + (g_wPassedClocks - g_wSyncedClocks);
 }
 
 // A table for the test
@@ -409,6 +403,7 @@ void K6502_Reset()
   // Reset Passed Clocks
   g_wPassedClocks = 0;
   g_wCurrentClocks = 0;
+  g_wSyncedClocks = 0;
 }
 
 /*===================================================================*/
@@ -481,8 +476,6 @@ static void __not_in_flash_func(step)(int wClocks)
   BYTE byD1;
   WORD wD0;
 
-  auto prePassedClocks = g_wPassedClocks;
-
   // It has a loop until a constant clock passes
   while (g_wPassedClocks < wClocks)
   {
@@ -1367,8 +1360,9 @@ static void __not_in_flash_func(step)(int wClocks)
   } /* end of while ... */
 
   // Correct the number of the clocks
-  g_wCurrentClocks += (g_wPassedClocks - prePassedClocks);
+  g_wCurrentClocks += (g_wPassedClocks - g_wSyncedClocks);
   g_wPassedClocks -= wClocks;
+  g_wSyncedClocks = g_wPassedClocks;
 }
 
 /*===================================================================*/
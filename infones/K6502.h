@@ -44,11 +44,33 @@ typedef unsigned char BYTE;
 #define VECTOR_RESET 0xfffc
 #define VECTOR_IRQ 0xfffe
 
+/* 6502 state in one struct, ordered by access frequency so that the
+   hottest fields sit within the short Thumb load / store offsets of its
+   base address. The fields keep the names of the globals they replace. */
+struct K6502_State_tag
+{
+  int g_wPassedClocks; /* The number of the clocks that it passed */
+  WORD PC;
+  BYTE A;
+  BYTE X;
+  BYTE Y;
+  BYTE F;
+  BYTE SP;
+  BYTE IRQ_State;  /* The state of the IRQ pin */
+  BYTE IRQ_Wiring; /* Wiring of the IRQ pin */
+  BYTE NMI_State;  /* The state of the NMI pin */
+  BYTE NMI_Wiring; /* Wiring of the NMI pin */
+  int g_wCurrentClocks;
+  int g_wSyncedClocks; /* g_wPassedClocks when g_wCurrentClocks was last brought up to date */
+};
+
+extern struct K6502_State_tag K6502_State;
+
 // NMI Request
-#define NMI_REQ NMI_State = 0;
+#define NMI_REQ K6502_State.NMI_State = 0;
 
 // IRQ Request
-#define IRQ_REQ IRQ_State = 0;
+#define IRQ_REQ K6502_State.IRQ_State = 0;
 
 // Emulator Operation
 void K6502_Init();
@@ -69,14 +91,6 @@ static inline BYTE K6502_ReadIY();
 static inline void K6502_Write(WORD wAddr, BYTE byData);
 static inline void K6502_WriteW(WORD wAddr, WORD wData);
 
-// The state of the IRQ pin
-extern BYTE IRQ_State;
-
-// The state of the NMI pin
-extern BYTE NMI_State;
-
-extern WORD PC;
-
 // The number of the clocks that it passed
 //extern WORD g_wPassedClocks;
 WORD getPassedClocks();
@@ -70,7 +70,9 @@ static inline BYTE __not_in_flash_func(K6502_Read)(WORD wAddr)
 
   if (wAddr >= 0x8000)
   {
-    return ROMBANK[(wAddr - 0x8000) >> 13][wAddr & 0x1fff];
+    const BYTE *pbyRom = &ROMBANK[(wAddr - 0x8000) >> 13][wAddr & 0x1fff];
+    XIP_READ(pbyRom);
+    return *pbyRom;
   }
 
   switch (wAddr & 0xe000)
@@ -125,23 +127,7 @@ static inline BYTE __not_in_flash_func(K6502_Read)(WORD wAddr)
     if (wAddr == 0x4015)
     {
       // APU control
-      byRet = APU_Reg[0x15];
-      if (ApuC1Atl > 0)
-        byRet |= (1 << 0);
-      if (ApuC2Atl > 0)
-        byRet |= (1 << 1);
-      if (!ApuC3Holdnote)
-      {
-        if (ApuC3Atl > 0)
-          byRet |= (1 << 2);
-      }
-      else
-      {
-        if (ApuC3Llc > 0)
-          byRet |= (1 << 2);
-      }
-      if (ApuC4Atl > 0)
-        byRet |= (1 << 3);
+      byRet = APU_Reg[0x15] | InfoNES_pAPUReadStatus();
 
       // FrameIRQ
       APU_Reg[0x15] &= ~0x40;
@@ -238,8 +224,8 @@ static inline void __not_in_flash_func(K6502_Write)(WORD wAddr, BYTE byData)
       PPU_R0 = byData;
       PPU_Increment = (PPU_R0 & R0_INC_ADDR) ? 32 : 1;
       PPU_NameTableBank = NAME_TABLE0 + (PPU_R0 & R0_NAME_ADDR);
-      PPU_BG_Base = (PPU_R0 & R0_BG_ADDR) ? ChrBuf + 256 * 64 : ChrBuf;
-      PPU_SP_Base = (PPU_R0 & R0_SP_ADDR) ? ChrBuf + 256 * 64 : ChrBuf;
+      PPU_BG_Base = (PPU_R0 & R0_BG_ADDR) ? 256 * 64 : 0;
+      PPU_SP_Base = (PPU_R0 & R0_SP_ADDR) ? 256 * 64 : 0;
       PPU_SP_Height = (PPU_R0 & R0_SP_SIZE) ? 16 : 8;
 
       // Account for Loopy's scrolling discoveries
@@ -327,11 +313,18 @@ static inline void __not_in_flash_func(K6502_Write)(WORD wAddr, BYTE byData)
       PPU_Addr += PPU_Increment;
       addr &= 0x3fff;
 
+#if defined(PPU_CORE1)
+      // Lines rendered on the other core read pattern and name tables in place
+      if (addr < 0x3f00 && (addr >= 0x2000 || byVramWriteEnable))
+        InfoNES_WaitDrawLine();
+#endif
+
       // Write to PPU Memory
       if (addr < 0x2000 && byVramWriteEnable)
       {
         // Pattern Data
         ChrBufUpdate |= (1 << (addr >> 10));
+        ++PatternGen;
         PPUBANK[addr >> 10][addr & 0x3ff] = byData;
       }
       else if (addr < 0x3f00) /* 0x2000 - 0x3eff */
@@ -345,14 +338,24 @@ static inline void __not_in_flash_func(K6502_Write)(WORD wAddr, BYTE byData)
         // Palette mirror
         PPURAM[0x3f10] = PPURAM[0x3f14] = PPURAM[0x3f18] = PPURAM[0x3f1c] =
             PPURAM[0x3f00] = PPURAM[0x3f04] = PPURAM[0x3f08] = PPURAM[0x3f0c] = byData;
-        PalTable[0x00] = PalTable[0x04] = PalTable[0x08] = PalTable[0x0c] =
-            PalTable[0x10] = PalTable[0x14] = PalTable[0x18] = PalTable[0x1c] = NesPalette[byData] | 0x8000;
+        WORD wColor = NesPalette[byData] | 0x8000;
+        // Games rewrite the whole palette every NMI, only a new color makes lines dirty
+        if (PalTable[0x00] != wColor)
+        {
+          PalTable[0x00] = PalTable[0x04] = PalTable[0x08] = PalTable[0x0c] =
+              PalTable[0x10] = PalTable[0x14] = PalTable[0x18] = PalTable[0x1c] = wColor;
+          ++PalTableGen;
+        }
       }
       else if (addr & 3)
       {
         // Palette
         PPURAM[addr] = byData;
-        PalTable[addr & 0x1f] = NesPalette[byData];
+        if (PalTable[addr & 0x1f] != NesPalette[byData])
+        {
+          PalTable[addr & 0x1f] = NesPalette[byData];
+          ++PalTableGen;
+        }
       }
     }
     break;
@@ -429,11 +432,12 @@ static inline void __not_in_flash_func(K6502_Write)(WORD wAddr, BYTE byData)
       break;
 
     case 0x16: /* 0x4016 */
-      // Reset joypad
+      // Reset joypad, latching the controllers as they are right now
       if (!(APU_Reg[0x16] & 1) && (byData & 1))
       {
         PAD1_Bit = 0;
         PAD2_Bit = 0;
+        InfoNES_PadLatch(&PAD1_Latch, &PAD2_Latch);
       }
       break;
 
@@ -480,6 +484,11 @@ static inline void __not_in_flash_func(K6502_Write)(WORD wAddr, BYTE byData)
   case 0xe000: /* ROM BANK 3 */
     // Write to Mapper
     MapperWrite(wAddr, byData);
+#if defined(ROM_CACHE)
+    // The code may jump into the new bank right away. A bank that is not
+    // in RAM yet is read from flash until the copy at the end of the line.
+    InfoNES_BankRemap();
+#endif
     break;
   }
 }
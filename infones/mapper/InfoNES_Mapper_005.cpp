@@ -4,10 +4,10 @@
 /*                                                                   */
 /*===================================================================*/
 
-BYTE Map5_Wram[0x2000 * 8];
-BYTE Map5_Ex_Ram[0x400];
-BYTE Map5_Ex_Vram[0x400];
-BYTE Map5_Ex_Nam[0x400];
+#define Map5_Wram (MapperRam.Map5.Wram)
+#define Map5_Ex_Ram (MapperRam.Map5.Ex_Ram)
+#define Map5_Ex_Vram (MapperRam.Map5.Ex_Vram)
+#define Map5_Ex_Nam (MapperRam.Map5.Ex_Nam)
 
 BYTE Map5_Prg_Reg[8];
 BYTE Map5_Wram_Reg[8];
@@ -4,7 +4,7 @@
 /*                                                                   */
 /*===================================================================*/
 
-BYTE Map19_Chr_Ram[0x2000];
+#define Map19_Chr_Ram (MapperRam.Map19_Chr_Ram)
 BYTE Map19_Regs[2];
 
 BYTE Map19_IRQ_Enable;
@@ -4,7 +4,7 @@
 /*                                                                   */
 /*===================================================================*/
 
-BYTE Map185_Dummy_Chr_Rom[ 0x400 ];
+#define Map185_Dummy_Chr_Rom (MapperRam.Map185_Dummy_Chr_Rom)
 
 /*-------------------------------------------------------------------*/
 /*  Initialize Mapper 185                                            */
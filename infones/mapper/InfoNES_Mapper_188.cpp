@@ -4,7 +4,7 @@
 /*                                                                   */
 /*===================================================================*/
 
-BYTE Map188_Dummy[ 0x2000 ];
+#define Map188_Dummy (MapperRam.Map188_Dummy)
 
 /*-------------------------------------------------------------------*/
 /*  Initialize Mapper 188                                            */
@@ -0,0 +1,214 @@
+#include "input.h"
+#include <atomic>
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include "gamepad.h"
+#include "nespad.h"
+#include "wiipad.h"
+
+namespace
+{
+    // NES pad read period, the shift itself takes the PIO a fraction of this
+    constexpr int64_t NESPAD_PERIOD_US = 1000;
+
+    // The Wii controller is read over I2C, not on every poll of the wait loop
+    constexpr uint32_t WIIPAD_PERIOD_US = 4000;
+
+    // One writer, any number of readers. A reader retries while a write is
+    // in progress, so a reader must never interrupt its own writer.
+    template <typename T>
+    class Seqlock
+    {
+    public:
+        void write(const T &v)
+        {
+            auto seq = seq_.load(std::memory_order_relaxed);
+            seq_.store(seq + 1, std::memory_order_relaxed); // Odd: write in progress
+            std::atomic_thread_fence(std::memory_order_release);
+            value_ = v;
+            seq_.store(seq + 2, std::memory_order_release);
+        }
+
+        T read() const
+        {
+            while (true)
+            {
+                auto seq = seq_.load(std::memory_order_acquire);
+                if (seq & 1)
+                {
+                    continue;
+                }
+                T v = value_;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq_.load(std::memory_order_relaxed) == seq)
+                {
+                    return v;
+                }
+            }
+        }
+
+    private:
+        std::atomic<uint32_t> seq_{0};
+        T value_{};
+    };
+
+    struct NesPads
+    {
+        uint8_t state[2];
+        uint32_t changedUs;
+    };
+
+    struct HostInputs
+    {
+        uint32_t usb[2];
+        bool usbConnected;
+        uint8_t wii;
+        uint32_t changedUs;
+    };
+
+    Seqlock<NesPads> nes_;     // Written by the timer IRQ
+    Seqlock<HostInputs> host_; // Written by input_poll()
+    bool started_ = false;
+
+    // Change being followed to the screen, only touched by core 0 thread code
+    uint32_t seenChangeUs_;
+    uint32_t trackedChangeUs_;
+    uint32_t trackedLatchUs_;
+    int trackedFrames_; // Frames until on screen, 0 when not following a change
+    InputStats stats_;
+
+#if NES_PIN_CLK != -1
+    repeating_timer_t nesTimer_;
+    volatile bool nesReading_ = false;
+
+    bool __not_in_flash_func(nesTimerCallback)(repeating_timer_t *)
+    {
+        if (nesReading_)
+        {
+            // Started a period ago, done by now
+            nespad_read_finish();
+            static NesPads last{};
+            if (nespad_states[0] != last.state[0] || nespad_states[1] != last.state[1])
+            {
+                last = {{nespad_states[0], nespad_states[1]}, time_us_32()};
+                nes_.write(last);
+            }
+        }
+        nespad_read_start();
+        nesReading_ = true;
+        return true;
+    }
+#endif
+
+#if WII_PIN_SDA >= 0 and WII_PIN_SCL >= 0
+    uint8_t wii_;
+    uint32_t wiiReadUs_;
+#endif
+}
+
+void input_start()
+{
+    if (started_)
+    {
+        return;
+    }
+    started_ = true;
+#if NES_PIN_CLK != -1
+    add_repeating_timer_us(-NESPAD_PERIOD_US, nesTimerCallback, nullptr, &nesTimer_);
+#endif
+    input_poll();
+}
+
+void input_stop()
+{
+    if (!started_)
+    {
+        return;
+    }
+    started_ = false;
+#if NES_PIN_CLK != -1
+    cancel_repeating_timer(&nesTimer_);
+    if (nesReading_)
+    {
+        nespad_read_finish();
+        nesReading_ = false;
+    }
+#endif
+}
+
+void input_poll()
+{
+    tuh_task();
+
+    HostInputs h{};
+    for (int i = 0; i < 2; ++i)
+    {
+        h.usb[i] = io::getCurrentGamePadState(i).buttons;
+    }
+    h.usbConnected = io::getCurrentGamePadState(0).isConnected();
+
+#if WII_PIN_SDA >= 0 and WII_PIN_SCL >= 0
+    uint32_t now = time_us_32();
+    if (now - wiiReadUs_ >= WIIPAD_PERIOD_US)
+    {
+        wii_ = wiipad_read();
+        wiiReadUs_ = now;
+    }
+    h.wii = wii_;
+#endif
+
+    static HostInputs last{};
+    if (h.usb[0] != last.usb[0] || h.usb[1] != last.usb[1] ||
+        h.usbConnected != last.usbConnected || h.wii != last.wii)
+    {
+        h.changedUs = time_us_32();
+        last = h;
+        host_.write(h);
+    }
+}
+
+void __not_in_flash_func(input_get_state)(InputState &state)
+{
+    auto nes = nes_.read();
+    auto host = host_.read();
+    state.usb[0] = host.usb[0];
+    state.usb[1] = host.usb[1];
+    state.usbConnected = host.usbConnected;
+    state.nes[0] = nes.state[0];
+    state.nes[1] = nes.state[1];
+    state.wii = host.wii;
+    // Whichever changed last
+    state.changedUs = static_cast<int32_t>(nes.changedUs - host.changedUs) > 0 ? nes.changedUs : host.changedUs;
+}
+
+void __not_in_flash_func(input_latched)(const InputState &state, int frames)
+{
+    if (state.changedUs == seenChangeUs_)
+    {
+        return;
+    }
+    seenChangeUs_ = state.changedUs;
+    if (trackedFrames_)
+    {
+        // Still following an earlier change
+        return;
+    }
+    trackedChangeUs_ = state.changedUs;
+    trackedLatchUs_ = time_us_32() - state.changedUs;
+    trackedFrames_ = frames;
+}
+
+void input_frame_done()
+{
+    if (trackedFrames_ && --trackedFrames_ == 0)
+    {
+        stats_.latchUs += trackedLatchUs_;
+        stats_.latencyUs += time_us_32() - trackedChangeUs_;
+        ++stats_.samples;
+    }
+}
+
+void input_get_stats(InputStats &stats)
+{
+    stats = stats_;
+}
@@ -0,0 +1,57 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+
+// Controller input, decoupled from the emulation frame.
+//
+// Each source publishes its latest state into a seqlock'd snapshot:
+// the NES pads from a repeating timer ( PIO reads, each tick finishes the
+// read the previous one started ), USB and the Wii classic controller
+// from input_poll(), which the frame loop calls while it waits.
+// InfoNES_PadState() and InfoNES_PadLatch() read the snapshots in constant
+// time and never wait for a device.
+//
+// Every snapshot carries the time its buttons last changed. The latency
+// telemetry follows one change at a time from that moment to the game's
+// $4016 strobe that latches it, and on to the end of the first frame
+// rendered after the latch, the point the frame reaches the screen.
+
+struct InputState
+{
+    uint32_t usb[2];   // io::GamePadState buttons of USB controllers 1 and 2
+    bool usbConnected; // USB controller 1 is connected
+    uint8_t nes[2];    // NES pads, NES button bits
+    uint8_t wii;       // Wii classic controller, NES button bits
+    uint32_t changedUs; // time_us_32() of the latest button change of any source
+};
+
+struct InputStats
+{
+    uint32_t samples;   // Changes followed to the screen
+    uint32_t latchUs;   // Sum of change to $4016 latch times
+    uint32_t latencyUs; // Sum of change to frame end times
+};
+
+// Start the NES pad timer. Call before the emulation starts, the menu reads the pads itself.
+void input_start();
+
+// Stop the timer and finish a read in progress.
+void input_stop();
+
+// Service USB host and read the Wii controller ( thread context, core 0 ).
+void input_poll();
+
+// Latest state of every source.
+void input_get_state(InputState &state);
+
+// The game latched state. Its effect is on screen after frames more calls of input_frame_done().
+void input_latched(const InputState &state, int frames);
+
+// A frame was handed to the screen.
+void input_frame_done();
+
+// Running totals, telemetry reports the differences.
+void input_get_stats(InputStats &stats);
+
+#endif // INPUT_H
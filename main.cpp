@@ -19,17 +19,38 @@
 #include "nespad.h"
 #include "wiipad.h"
 #include "FrensHelpers.h"
+#include "screen_dispatch.h"
 #include "settings.h"
 #include "FrensFonts.h"
 #include "nvram.h"
+#include "game_config.h"
+#include "telemetry.h"
+#include "scanout.h"
+#include "input.h"
+#include "rom_cache.h"
+#include "xip_stats.h"
 
 bool isFatalError = false;
 
 char *romName;
 
 static bool fps_enabled = false;
+// Lines InfoNES_PostDrawLine() draws the frame rate over
+static constexpr int FPS_OVERLAY_FIRST = 8;
+static constexpr int FPS_OVERLAY_LINES = 8;
 static uint32_t start_tick_us = 0;
 static uint32_t fps = 0;
+#if defined(XIP_STATS)
+// XIP cache hit rate of the previous frame, drawn after the frame rate
+static uint32_t xip_pct = 0;
+#endif
+
+// Audio quality a game starts with until it is changed with SELECT + LEFT/RIGHT
+#if defined(SPI_SCREEN) && !defined(AUDIO_SINK)
+constexpr int DEFAULT_AUDIO_QUALITY = 0; // No audio sink, skip the synthesis
+#else
+constexpr int DEFAULT_AUDIO_QUALITY = pAPU_QUALITY;
+#endif
 
 constexpr uint32_t CPUFreqKHz = 252000;
 
@@ -45,6 +66,15 @@ namespace
 #define INFONES_LINE_BUFFER_OFFSET 0 // was 32, but I think that's maybe wrong?
 
 // Convert RGB555 to RGB565 with proper bit expansion
+#if defined(SPI_SCREEN_RGB444)
+// RGB555: 0RRRRR GGGGG BBBBB -> RGB444: 0000 RRRR GGGG BBBB
+// Keep the top 4 bits of each component, the panel is driven at 12 bpp (see rgb444.h)
+#define CC(x) ( \
+    (((x) & 0x7800) >> 3) | /* Red: bits 14-11 -> 11-8 */ \
+    (((x) & 0x03C0) >> 2) | /* Green: bits 9-6 -> 7-4 */ \
+    (((x) & 0x001E) >> 1)   /* Blue: bits 4-1 -> 3-0 */ \
+)
+#else
 // RGB555: 0RRRRR GGGGG BBBBB -> RGB565: RRRRR GGGGGG BBBBB
 // Red and Blue stay 5 bits, Green expands from 5 to 6 by replicating MSB
 #define CC(x) ( \
@@ -53,6 +83,7 @@ namespace
     (((x) & 0x0200) >> 4) | /* Green MSB: bit 9 -> 5 */ \
     ((x) & 0x001F)          /* Blue: bits 4-0 stay */ \
 )
+#endif
 const WORD __not_in_flash_func(NesPalette)[64] = {
     CC(0x39ce), CC(0x1071), CC(0x0015), CC(0x2013), CC(0x440e), CC(0x5402), CC(0x5000), CC(0x3c20),
     CC(0x20a0), CC(0x0100), CC(0x0140), CC(0x00e2), CC(0x0ceb), CC(0x0000), CC(0x0000), CC(0x0000),
@@ -66,78 +97,103 @@ const WORD __not_in_flash_func(NesPalette)[64] = {
 static DWORD prevButtons[2]{};
 static int rapidFireMask[2]{};
 static int rapidFireCounter = 0;
-void InfoNES_PadState(DWORD *pdwPad1, DWORD *pdwPad2, DWORD *pdwSystem)
+static constexpr int LEFT = 1 << 6;
+static constexpr int RIGHT = 1 << 7;
+static constexpr int UP = 1 << 4;
+static constexpr int DOWN = 1 << 5;
+static constexpr int SELECT = 1 << 2;
+static constexpr int START = 1 << 3;
+static constexpr int A = 1 << 0;
+static constexpr int B = 1 << 1;
+
+// NES buttons of controller i from every source
+static int __not_in_flash_func(padButtons)(const InputState &input, int i)
 {
-    static constexpr int LEFT = 1 << 6;
-    static constexpr int RIGHT = 1 << 7;
-    static constexpr int UP = 1 << 4;
-    static constexpr int DOWN = 1 << 5;
-    static constexpr int SELECT = 1 << 2;
-    static constexpr int START = 1 << 3;
-    static constexpr int A = 1 << 0;
-    static constexpr int B = 1 << 1;
-
-    ++rapidFireCounter;
-    bool reset = false;
-    bool usbConnected = false;
-    for (int i = 0; i < 2; ++i)
-    {
-        auto &dst = i == 0 ? *pdwPad1 : *pdwPad2;
-        auto &gp = io::getCurrentGamePadState(i);
-        if ( i == 0 )
-        {
-            usbConnected = gp.isConnected();
-        }
-        int v = (gp.buttons & io::GamePadState::Button::LEFT ? LEFT : 0) |
-                (gp.buttons & io::GamePadState::Button::RIGHT ? RIGHT : 0) |
-                (gp.buttons & io::GamePadState::Button::UP ? UP : 0) |
-                (gp.buttons & io::GamePadState::Button::DOWN ? DOWN : 0) |
-                (gp.buttons & io::GamePadState::Button::A ? A : 0) |
-                (gp.buttons & io::GamePadState::Button::B ? B : 0) |
-                (gp.buttons & io::GamePadState::Button::SELECT ? SELECT : 0) |
-                (gp.buttons & io::GamePadState::Button::START ? START : 0) |
-                0;
+    bool usbConnected = input.usbConnected;
+    auto buttons = input.usb[i];
+    int v = (buttons & io::GamePadState::Button::LEFT ? LEFT : 0) |
+            (buttons & io::GamePadState::Button::RIGHT ? RIGHT : 0) |
+            (buttons & io::GamePadState::Button::UP ? UP : 0) |
+            (buttons & io::GamePadState::Button::DOWN ? DOWN : 0) |
+            (buttons & io::GamePadState::Button::A ? A : 0) |
+            (buttons & io::GamePadState::Button::B ? B : 0) |
+            (buttons & io::GamePadState::Button::SELECT ? SELECT : 0) |
+            (buttons & io::GamePadState::Button::START ? START : 0) |
+            0;
 #if NES_PIN_CLK != -1
-        // When USB controller is connected both NES ports act as controller 2
-        if (usbConnected)
-        {          
-            if (i == 1)
-            {
-                v = v | nespad_states[1] | nespad_states[0];
-            }
-        }
-        else
+    // When USB controller is connected both NES ports act as controller 2
+    if (usbConnected)
+    {          
+        if (i == 1)
         {
-            v |= nespad_states[i];
+            v = v | input.nes[1] | input.nes[0];
         }
+    }
+    else
+    {
+        v |= input.nes[i];
+    }
 #endif
 
 // When USB controller is connected  wiipad acts as controller 2 
 #if WII_PIN_SDA >= 0 and WII_PIN_SCL >= 0
-        if (usbConnected)
+    if (usbConnected)
+    {
+        if (i == 1)
         {
-            if (i == 1)
-            {
-                v |= wiipad_read();
-            }
+            v |= input.wii;
         }
-        else // if no USB controller is connected, wiipad acts as controller 1
+    }
+    else // if no USB controller is connected, wiipad acts as controller 1
+    {
+        if (i == 0)
         {
-            if (i == 0)
-            {
-                v |= wiipad_read();
-            }
+            v |= input.wii;
         }
+    }
 #endif
+    return v;
+}
 
-        int rv = v;
-        if (rapidFireCounter & 2)
-        {
-            // 15 fire/sec
-            rv &= ~rapidFireMask[i];
-        }
+// What the game reads, rapid fire releases the masked buttons 2 frames out of 4
+static inline int latchedButtons(int v, int i)
+{
+    if (rapidFireCounter & 2)
+    {
+        // 15 fire/sec
+        v &= ~rapidFireMask[i];
+    }
+    return v;
+}
+
+// The game strobes $4016: latch the controllers as they are right now
+void __not_in_flash_func(InfoNES_PadLatch)(DWORD *pdwPad1, DWORD *pdwPad2)
+{
+    InputState input;
+    input_get_state(input);
+    *pdwPad1 = latchedButtons(padButtons(input, 0), 0);
+    *pdwPad2 = latchedButtons(padButtons(input, 1), 1);
+
+    // A strobe after line 240 is in time for the next frame, earlier lines are already drawn
+    input_latched(input, PPU_Scanline >= SCAN_UNKNOWN_START ? 1 : 2);
+}
+
+// Once per frame at V-Blank: rapid fire phase and hotkeys
+void InfoNES_PadState(DWORD *pdwPad1, DWORD *pdwPad2, DWORD *pdwSystem)
+{
+    ++rapidFireCounter;
+    bool reset = false;
+
+    // Latest published state, no device is read here
+    InputState input;
+    input_get_state(input);
+    for (int i = 0; i < 2; ++i)
+    {
+        auto &dst = i == 0 ? *pdwPad1 : *pdwPad2;
+        int v = padButtons(input, i);
 
-        dst = rv;
+        // Games that read without strobing see this one
+        dst = latchedButtons(v, i);
 
         auto p1 = v;
 
@@ -149,6 +205,7 @@ void InfoNES_PadState(DWORD *pdwPad1, DWORD *pdwPad2, DWORD *pdwSystem)
             if (pushed & A)
             {
                 fps_enabled = !fps_enabled;
+                InfoNES_InvalidateLines(FPS_OVERLAY_FIRST, FPS_OVERLAY_LINES);
             }
         }
         if (p1 & SELECT)
@@ -156,6 +213,7 @@ void InfoNES_PadState(DWORD *pdwPad1, DWORD *pdwPad2, DWORD *pdwSystem)
             if (pushed & START)
             {
                 nvram_save();
+                game_config_save({static_cast<uint8_t>(InfoNES_pAPUGetQuality())});
                 reset = true;
             }
             if (pushed & A)
@@ -169,10 +227,20 @@ void InfoNES_PadState(DWORD *pdwPad1, DWORD *pdwPad2, DWORD *pdwSystem)
             if (pushed & UP)
             {
                 scaleMode8_7_ = Frens::screenMode(-1);
+                InfoNES_InvalidateLines();
             }
             else if (pushed & DOWN)
             {
                 scaleMode8_7_ = Frens::screenMode(+1);
+                InfoNES_InvalidateLines();
+            }
+            if (pushed & (LEFT | RIGHT))
+            {
+                // Audio quality, stored for this game when quitting
+                int quality = std::clamp(InfoNES_pAPUGetQuality() + (pushed & LEFT ? -1 : 1),
+                                         0, pAPU_QUALITY_MAX);
+                InfoNES_pAPUSetQuality(quality);
+                printf("Audio quality %d\n", quality);
             }
         }
 
@@ -235,6 +303,9 @@ bool parseROM(const uint8_t *nesFile)
 
 void InfoNES_ReleaseRom()
 {
+#if defined(ROM_CACHE)
+    rom_cache_release();
+#endif
     ROM = nullptr;
     VROM = nullptr;
 }
@@ -242,30 +313,43 @@ void InfoNES_ReleaseRom()
 // InfoNES_Wait implementation for slow motion control
 // Removed - using InfoNES_LoadFrame instead to avoid redefinition
 
-extern WORD PC;
-
 // Frame timing - ~60.0988 FPS in microseconds
 constexpr uint32_t FRAME_TIME_US = 16639;
+// Longest sleep between two input polls when no interrupt comes first
+constexpr uint32_t INPUT_POLL_US = 1000;
 static uint32_t next_frame_time_us = 0;
+#if defined(PACE_TO_DISPLAY)
+// DVI frame the previous emulator frame started on
+static uint32_t display_frame = 0;
+#endif
+
+static inline bool frameDue(uint32_t current_time_us)
+{
+#if defined(PACE_TO_DISPLAY)
+    return screen::getFrameCounter() != display_frame;
+#else
+    return static_cast<int32_t>(current_time_us - next_frame_time_us) >= 0;
+#endif
+}
 
 int InfoNES_LoadFrame()
 {
-#if NES_PIN_CLK != -1
-    nespad_read_start();
+#if defined(XIP_STATS)
+    // The frame pacing below is charged to the next frame
+    xip_stats_frame();
 #endif
-    auto count = dvi_->getFrameCounter();
+    auto count = screen::getFrameCounter();
     auto onOff = hw_divider_s32_quotient_inlined(count, 60) & 1;
     Frens::blinkLed(onOff);
-#if NES_PIN_CLK != -1
-    nespad_read_finish(); // Sets global nespad_state var
-#endif
-    tuh_task();
+    input_frame_done();
+    input_poll();
 
     // Frame rate limiting
     uint32_t current_time_us = Frens::time_us();
+    uint32_t idle_us = 0;
 
-    // Wait until it's time for the next frame
-    while (current_time_us < next_frame_time_us) {
+    // Sleep until it's time for the next frame
+    while (!frameDue(current_time_us)) {
         // Check for slow motion during wait
         if (!gpio_get(SLOW_MOTION_GPIO)) {
             sleep_us(SLOW_MOTION_DELAY_US);
@@ -273,25 +357,60 @@ int InfoNES_LoadFrame()
             next_frame_time_us = Frens::time_us() + FRAME_TIME_US;
             break;
         }
-        // Service USB instead of idle-spinning: drains completed gamepad
-        // reports and re-arms the next IN transfer immediately, so the device
-        // is polled repeatedly within the frame and gp.buttons is fresh when
-        // InfoNES_PadState() latches on the next scanline.
-        tuh_task();
+        // Service USB on every wake-up: drains completed gamepad reports and
+        // re-arms the next IN transfer immediately, so the device is polled
+        // repeatedly within the frame and the published state is fresh when
+        // the game strobes the pads.
+        input_poll();
+
+        // WFE until an interrupt ( USB, the NES pad timer ) or the alarm at
+        // the deadline, at most INPUT_POLL_US so the Wii pad is still read
+        uint32_t wait_start_us = Frens::time_us();
+        int32_t wait_us = INPUT_POLL_US;
+#if !defined(PACE_TO_DISPLAY)
+        // Signed, input_poll() may have run past the deadline
+        wait_us = std::min(wait_us, static_cast<int32_t>(next_frame_time_us - wait_start_us));
+        if (wait_us <= 0) {
+            current_time_us = wait_start_us;
+            continue;
+        }
+#endif
+        best_effort_wfe_or_timeout(delayed_by_us(get_absolute_time(), wait_us));
         current_time_us = Frens::time_us();
+        idle_us += current_time_us - wait_start_us;
     }
 
+#if defined(PACE_TO_DISPLAY)
+    display_frame = screen::getFrameCounter();
+#else
     // Schedule next frame (or catch up if we're behind)
-    next_frame_time_us = std::max(next_frame_time_us + FRAME_TIME_US,
-                                  current_time_us + FRAME_TIME_US - FRAME_TIME_US);
+    next_frame_time_us += FRAME_TIME_US;
+    if (static_cast<int32_t>(current_time_us - next_frame_time_us) > 0)
+    {
+        next_frame_time_us = current_time_us;
+    }
+#endif
 
     // Frame rate calculation (if enabled)
     if (fps_enabled)
     {
         // calculate fps and round to nearest value (instead of truncating/floor)
         uint32_t tick_us = current_time_us - start_tick_us;
+        uint32_t prevFps = fps;
         fps = (1000000 - 1) / tick_us + 1;
         start_tick_us = current_time_us;
+        bool redraw = fps != prevFps;
+#if defined(XIP_STATS)
+        uint32_t prevXipPct = xip_pct;
+        xip_pct = std::min<uint32_t>(xip_stats_frame_hit_pct(), 99);
+        redraw |= xip_pct != prevXipPct;
+#endif
+        if (redraw)
+        {
+            // The overlay digits are drawn after rendering, redraw their lines
+            InfoNES_InvalidateLines(FPS_OVERLAY_FIRST, FPS_OVERLAY_LINES);
+        }
+        telemetry_frame(current_time_us, idle_us);
     }
     return count;
 }
@@ -299,6 +418,38 @@ int InfoNES_LoadFrame()
 namespace
 {
     dvi::DVI::LineBuffer *currentLineBuffer_{};
+#if defined(PPU_CORE1)
+    bool currentLineDeferred_{};
+#endif
+
+#if defined(DECIMATED_RENDER)
+    // Source rows that survive the SPI screen's nearest-neighbour downsampling.
+    // Output row r samples source row r * factor / 100, so every other row is dropped.
+    bool visibleLines_[NES_DISP_HEIGHT];
+
+    void initVisibleLines()
+    {
+        for (int row = 0;; ++row)
+        {
+            int src = row * DECIMATED_RENDER_FACTOR / 100;
+            if (src >= NES_DISP_HEIGHT)
+            {
+                break;
+            }
+            visibleLines_[src] = true;
+        }
+    }
+#endif
+}
+
+bool __not_in_flash_func(InfoNES_IsLineVisible)(int line)
+{
+#if defined(DECIMATED_RENDER)
+    // Same row numbering as setLineBuffer() below
+    return visibleLines_[line - 4];
+#else
+    return true;
+#endif
 }
 
 void __not_in_flash_func(drawWorkMeterUnit)(int timing,
@@ -340,8 +491,16 @@ void __not_in_flash_func(InfoNES_PreDrawLine)(int line)
 {
 
     util::WorkMeterMark(0xaaaa);
-    auto b = dvi_->getLineBuffer();
+#if defined(SCANOUT_QUEUE)
+    auto b = scanout_acquire_line();
+#else
+    auto b = screen::getLineBuffer();
+#endif
     util::WorkMeterMark(0x5555);
+#if defined(XIP_STATS)
+    // Waiting for the line buffer is not background rendering
+    InfoNES_XipPhase(XIP_PHASE_OTHER);
+#endif
     // b.size --> 640
     // printf("Pre Draw%d\n", b->size());
     // WORD = 2 bytes
@@ -353,6 +512,34 @@ void __not_in_flash_func(InfoNES_PreDrawLine)(int line)
     currentLineBuffer_ = b;
 }
 
+static inline bool hasFpsOverlay(int line)
+{
+    return fps_enabled && line >= FPS_OVERLAY_FIRST && line < FPS_OVERLAY_FIRST + FPS_OVERLAY_LINES;
+}
+
+#if defined(PPU_CORE1)
+CapturedLine *__not_in_flash_func(InfoNES_DeferDrawLine)(int line)
+{
+#if !defined(NDEBUG)
+    // The work meter is drawn over every line
+    return nullptr;
+#else
+    // Anything drawn over the line has to wait for the pixels
+    if (hasFpsOverlay(line))
+    {
+        return nullptr;
+    }
+    currentLineDeferred_ = true;
+    return scanout_line_state(currentLineBuffer_);
+#endif
+}
+
+void __not_in_flash_func(InfoNES_WaitDrawLine)()
+{
+    scanout_wait_rendered();
+}
+#endif
+
 void __not_in_flash_func(InfoNES_PostDrawLine)(int line)
 {
 #if !defined(NDEBUG)
@@ -360,9 +547,16 @@ void __not_in_flash_func(InfoNES_PostDrawLine)(int line)
     drawWorkMeter(line);
 #endif
     // Display frame rate
-    if (fps_enabled && line >= 8 && line < 16)
+    if (hasFpsOverlay(line))
     {
+#if defined(XIP_STATS)
+        char fpsString[5];
+        fpsString[2] = ' ';
+        fpsString[3] = '0' + (xip_pct / 10);
+        fpsString[4] = '0' + (xip_pct % 10);
+#else
         char fpsString[2];
+#endif
         WORD *fpsBuffer = currentLineBuffer_->data() + 40;
         WORD fgc = NesPalette[48];
         WORD bgc = NesPalette[15];
@@ -370,7 +564,7 @@ void __not_in_flash_func(InfoNES_PostDrawLine)(int line)
         fpsString[1] = '0' + (fps % 10);
 
         int rowInChar = line % 8;
-        for (auto i = 0; i < 2; i++)
+        for (auto i = 0; i < static_cast<int>(sizeof(fpsString)); i++)
         {
             char firstFpsDigit = fpsString[i];
             char fontSlice = getcharslicefrom8x8font(firstFpsDigit, rowInChar);
@@ -390,7 +584,14 @@ void __not_in_flash_func(InfoNES_PostDrawLine)(int line)
     }
 
     assert(currentLineBuffer_);
-    dvi_->setLineBuffer(line-4, currentLineBuffer_);
+#if defined(PPU_CORE1)
+    scanout_submit_line(line - 4, currentLineBuffer_, currentLineDeferred_);
+    currentLineDeferred_ = false;
+#elif defined(SCANOUT_QUEUE)
+    scanout_submit_line(line - 4, currentLineBuffer_);
+#else
+    screen::setLineBuffer(line - 4, currentLineBuffer_);
+#endif
     currentLineBuffer_ = nullptr;
 }
 
@@ -408,11 +609,24 @@ bool loadAndReset()
         printf("NES file parse error.\n");
         return false;
     }
+#if defined(XIP_STATS)
+    // Where the ROM lies in flash, before the cache below copies it
+    xip_stats_load();
+#endif
+#if defined(ROM_CACHE)
+    // Before InfoNES_Reset(), the mapper maps the first banks from wherever ROM points
+    rom_cache_load();
+#endif
     if (!nvram_load())
     {
         printf("NVRAM load failed.\n");
     }
 
+    // Applied by InfoNES_Reset() below
+    GameConfig config{DEFAULT_AUDIO_QUALITY};
+    game_config_load(config);
+    InfoNES_pAPUSetQuality(config.audioQuality);
+
     if (InfoNES_Reset() < 0)
     {
         printf("NES reset error.\n");
@@ -467,12 +681,16 @@ int main()
     printf("Mapper 5 is disabled\n");
 #endif
     isFatalError =  !Frens::initAll(selectedRom, CPUFreqKHz, 4, 4 );
+#if defined(DECIMATED_RENDER)
+    initVisibleLines();
+#endif
     scaleMode8_7_ = Frens::applyScreenMode(settings.screenMode);
     bool showSplash = true;
 
     // Initialize NVRAM module after ROMSelector is likely initialized within initAll or similar
     // We pass the global romName and ErrorMessage buffers
     nvram_init(&romSelector_, romName, ErrorMessage);
+    game_config_init(romName);
 
 #if defined(BOOT_FROM_FLASH_ROM) && defined(STATIC_ROM_IN_FLASH)
     printf("BOOT_FROM_FLASH_ROM & STATIC_ROM_IN_FLASH: Booting directly into ROM.\n");
@@ -481,7 +699,15 @@ int main()
     // Proceed directly to InfoNES_Main
     printf("Now playing: %s\n", selectedRom);
     romSelector_.init(ROM_FILE_ADDR); // ROM_FILE_ADDR should be set by FrensHelpers::initAll
+#if defined(SCANOUT_QUEUE)
+    scanout_start();
+#endif
+    input_start();
     InfoNES_Main();
+    input_stop();
+#if defined(SCANOUT_QUEUE)
+    scanout_stop();
+#endif
     // After InfoNES_Main finishes (e.g., user quits game), what should happen?
     // For now, we'll just enter an infinite loop to prevent further execution.
     // Or, perhaps, a watchdog reboot if that's preferred.
@@ -500,11 +726,20 @@ int main()
         // Re-initialize NVRAM in case romName changed (selected via menu)
 
         nvram_init(&romSelector_, romName, ErrorMessage); // Pass dependencies
+        game_config_init(romName);
 
 
         // printf("Now playing: %s\n", selectedRom);
         romSelector_.init(ROM_FILE_ADDR);
+#if defined(SCANOUT_QUEUE)
+        scanout_start();
+#endif
+        input_start();
         InfoNES_Main();
+        input_stop();
+#if defined(SCANOUT_QUEUE)
+        scanout_stop();
+#endif
         selectedRom[0] = 0;
         showSplash = false;
     }
@@ -0,0 +1,246 @@
+#include "panel_sink.h"
+
+#if defined(SCANOUT_QUEUE)
+#include <algorithm>
+#include "pico/stdlib.h"
+#include "InfoNES.h"
+#include "rgb444.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#endif
+
+namespace
+{
+    static_assert(PANEL_DOWNSAMPLING_FACTOR >= 100, "the sink only drops rows and columns");
+
+    // MIPI DCS commands
+    constexpr uint8_t DCS_SET_COLUMN_ADDRESS = 0x2a;
+    constexpr uint8_t DCS_SET_PAGE_ADDRESS = 0x2b;
+    constexpr uint8_t DCS_WRITE_MEMORY_START = 0x2c;
+    constexpr uint8_t DCS_SET_PIXEL_FORMAT = 0x3a;
+
+    // Interface pixel formats
+    constexpr uint8_t PIXEL_FORMAT_12BIT = 0x03;
+    constexpr uint8_t PIXEL_FORMAT_16BIT = 0x05;
+
+    constexpr int MAX_LINE_BYTES = MIPI_DISPLAY_WIDTH * 2;
+
+    uint8_t columns_[MIPI_DISPLAY_WIDTH]; // Source column of each panel column
+    int width_;                           // Panel columns that have one
+    uint8_t buffers_[2][MAX_LINE_BYTES];  // One is converted while the other is sent
+    int next_;
+    PanelSinkStats stats_;
+
+    // Panel row that shows source row `line`, -1 if it is dropped
+    inline int panelRow(int line)
+    {
+        if (line < 0)
+        {
+            return -1;
+        }
+        int row = (line * 100 + PANEL_DOWNSAMPLING_FACTOR - 1) / PANEL_DOWNSAMPLING_FACTOR;
+        return row < MIPI_DISPLAY_HEIGHT && row * PANEL_DOWNSAMPLING_FACTOR / 100 == line ? row : -1;
+    }
+
+#if defined(SPI_SCREEN_RGB444)
+    // Two 0x0RGB pixels in three bytes ( see rgb444.h )
+    int __not_in_flash_func(convert)(const uint16_t *pixels, uint8_t *dst)
+    {
+        uint16_t row[MIPI_DISPLAY_WIDTH];
+        for (int x = 0; x < width_; ++x)
+        {
+            row[x] = pixels[columns_[x]];
+        }
+        return rgb444_pack(row, dst, width_);
+    }
+#else
+    // Big endian RGB565, the byte order the panel reads
+    int __not_in_flash_func(convert)(const uint16_t *pixels, uint8_t *dst)
+    {
+        for (int x = 0; x < width_; ++x)
+        {
+            uint16_t c = pixels[columns_[x]];
+            *dst++ = c >> 8;
+            *dst++ = c;
+        }
+        return width_ * 2;
+    }
+#endif
+
+    void initColumns()
+    {
+        width_ = 0;
+        for (int x = 0; x < MIPI_DISPLAY_WIDTH; ++x)
+        {
+            int src = x * PANEL_DOWNSAMPLING_FACTOR / 100;
+            if (src >= NES_DISP_WIDTH)
+            {
+                break;
+            }
+            columns_[width_++] = src;
+        }
+    }
+
+#if PICO_ON_DEVICE
+    int channel_ = -1;
+    uint32_t cr0_; // pico-screens' SPI frame format, restored on stop
+
+    inline spi_inst_t *port()
+    {
+        return MIPI_DISPLAY_SPI_PORT;
+    }
+
+    // The DMA is done and the last bit has left the shift register
+    inline void __not_in_flash_func(waitIdle)()
+    {
+        dma_channel_wait_for_finish_blocking(channel_);
+        while (spi_is_busy(port()))
+        {
+        }
+    }
+
+    // The SPI must be idle, the data phase is left open for a DMA to follow
+    void __not_in_flash_func(command)(uint8_t cmd, const uint8_t *params, size_t size)
+    {
+        gpio_put(MIPI_DISPLAY_PIN_DC, 0);
+        spi_write_blocking(port(), &cmd, 1);
+        gpio_put(MIPI_DISPLAY_PIN_DC, 1);
+        if (size)
+        {
+            spi_write_blocking(port(), params, size);
+        }
+    }
+
+    inline void __not_in_flash_func(startTransfer)(const uint8_t *data, int size)
+    {
+        dma_channel_transfer_from_buffer_now(channel_, data, size);
+    }
+#else
+    uint64_t busyUntil_; // End of the modelled DMA
+    std::vector<PanelTransfer> transfers_;
+
+    // Time the SPI needs for `size` bytes
+    uint64_t wireUs(size_t size)
+    {
+        return (static_cast<uint64_t>(size) * 8 * 1000000 + MIPI_DISPLAY_SPI_CLOCK_SPEED_HZ - 1) /
+               MIPI_DISPLAY_SPI_CLOCK_SPEED_HZ;
+    }
+
+    void waitIdle()
+    {
+        while (time_us_64() < busyUntil_)
+        {
+        }
+    }
+
+    // Blocking, like spi_write_blocking()
+    void command(uint8_t cmd, const uint8_t *params, size_t size)
+    {
+        busyUntil_ = time_us_64() + wireUs(1 + size);
+        waitIdle();
+    }
+
+    void startTransfer(const uint8_t *data, int size)
+    {
+        busyUntil_ = time_us_64() + wireUs(size);
+    }
+#endif
+
+    void __not_in_flash_func(setWindow)(uint8_t cmd, int first, int last)
+    {
+        uint8_t params[] = {static_cast<uint8_t>(first >> 8), static_cast<uint8_t>(first),
+                            static_cast<uint8_t>(last >> 8), static_cast<uint8_t>(last)};
+        command(cmd, params, sizeof(params));
+    }
+}
+
+void panel_sink_start()
+{
+    initColumns();
+    next_ = 0;
+#if PICO_ON_DEVICE
+    if (channel_ < 0)
+    {
+        channel_ = dma_claim_unused_channel(true);
+        dma_channel_config c = dma_channel_get_default_config(channel_);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+        channel_config_set_dreq(&c, spi_get_dreq(port(), true));
+        dma_channel_configure(channel_, &c, &spi_get_hw(port())->dr, buffers_[0], 0, false);
+    }
+
+    // pico-screens may have left the port in 16 bit frames
+    cr0_ = spi_get_hw(port())->cr0;
+    spi_set_format(port(), 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_put(MIPI_DISPLAY_PIN_CS, 0);
+#else
+    busyUntil_ = 0;
+    transfers_.clear();
+#endif
+#if defined(SPI_SCREEN_RGB444)
+    // Only the game is drawn at 12 bpp, pico-screens and the menu stay at 16
+    command(DCS_SET_PIXEL_FORMAT, &PIXEL_FORMAT_12BIT, 1);
+#endif
+    // Every line has the same columns, only the row changes
+    setWindow(DCS_SET_COLUMN_ADDRESS, MIPI_DISPLAY_OFFSET_X, MIPI_DISPLAY_OFFSET_X + width_ - 1);
+}
+
+void panel_sink_stop()
+{
+    waitIdle();
+#if defined(SPI_SCREEN_RGB444)
+    command(DCS_SET_PIXEL_FORMAT, &PIXEL_FORMAT_16BIT, 1);
+#endif
+#if PICO_ON_DEVICE
+    gpio_put(MIPI_DISPLAY_PIN_CS, 1);
+    spi_set_format(port(), ((cr0_ & SPI_SSPCR0_DSS_BITS) >> SPI_SSPCR0_DSS_LSB) + 1,
+                   static_cast<spi_cpol_t>((cr0_ & SPI_SSPCR0_SPO_BITS) >> SPI_SSPCR0_SPO_LSB),
+                   static_cast<spi_cpha_t>((cr0_ & SPI_SSPCR0_SPH_BITS) >> SPI_SSPCR0_SPH_LSB),
+                   SPI_MSB_FIRST);
+#endif
+}
+
+void __not_in_flash_func(panel_sink_send_line)(int line, const uint16_t *pixels)
+{
+    int row = panelRow(line);
+    if (row < 0)
+    {
+        return;
+    }
+
+    // The other buffer may still be on the wire
+    uint8_t *buffer = buffers_[next_];
+    next_ ^= 1;
+    int size = convert(pixels, buffer);
+
+    uint32_t t0 = time_us_32();
+    waitIdle();
+    uint32_t waitUs = time_us_32() - t0;
+    stats_.waitUs += waitUs;
+
+    int y = MIPI_DISPLAY_OFFSET_Y + row;
+    setWindow(DCS_SET_PAGE_ADDRESS, y, y);
+    command(DCS_WRITE_MEMORY_START, nullptr, 0);
+    startTransfer(buffer, size);
+#if !PICO_ON_DEVICE
+    transfers_.push_back({row, static_cast<uint32_t>(busyUntil_ - wireUs(size)),
+                          static_cast<uint32_t>(busyUntil_), waitUs, {buffer, buffer + size}});
+#endif
+    ++stats_.lines;
+    stats_.bytes += size;
+}
+
+void panel_sink_get_stats(PanelSinkStats &stats)
+{
+    stats = stats_;
+}
+
+#if !PICO_ON_DEVICE
+const std::vector<PanelTransfer> &panel_sink_get_transfers()
+{
+    return transfers_;
+}
+#endif
+#endif
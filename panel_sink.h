@@ -0,0 +1,88 @@
+#ifndef PANEL_SINK_H
+#define PANEL_SINK_H
+
+#include <stdint.h>
+
+// Line output to the SPI panel for the scan-out on core 1 (SCANOUT_QUEUE).
+//
+// The pico-screens backend copies each line into its own buffer and sends
+// it with blocking SPI writes, core 1 did nothing else meanwhile. The sink
+// reads the line straight from the scan-out pool instead: it downsamples
+// it into one of two DMA buffers, waits for the DMA of the line before,
+// sets the panel row and starts the DMA of this one. The pool buffer is
+// free again once the line is downsampled, and the next line is
+// downsampled while this one is on the wire.
+// Rows and columns are dropped nearest neighbour, output row r shows
+// source row r * PANEL_DOWNSAMPLING_FACTOR / 100 like main.cpp renders
+// them ( DECIMATED_RENDER ), the same for the columns.
+// Pixels go out as big endian RGB565. With SPI_SCREEN_RGB444 the panel is
+// switched to 12 bpp for the game and rgb444_pack() packs each line.
+// pico-screens still sets the panel up and draws the menu. The sink
+// borrows the SPI port and the DC and CS pins from panel_sink_start()
+// to panel_sink_stop().
+// On the host (PICO_ON_DEVICE == 0) there is no panel: a transfer is
+// modelled as taking the time its bytes need at the SPI clock, the next
+// line waits for it the same way, and every transfer is recorded.
+
+#ifndef PANEL_DOWNSAMPLING_FACTOR
+#define PANEL_DOWNSAMPLING_FACTOR 199 // Percent, PICO_SCREENS_DOWNSAMPLING_FACTOR
+#endif
+
+// The panel pico-screens drives, see its definitions in CMakeLists.txt
+#ifndef MIPI_DISPLAY_WIDTH
+#define MIPI_DISPLAY_WIDTH 128
+#endif
+
+#ifndef MIPI_DISPLAY_HEIGHT
+#define MIPI_DISPLAY_HEIGHT 128
+#endif
+
+#ifndef MIPI_DISPLAY_OFFSET_X
+#define MIPI_DISPLAY_OFFSET_X 0
+#endif
+
+#ifndef MIPI_DISPLAY_OFFSET_Y
+#define MIPI_DISPLAY_OFFSET_Y 0
+#endif
+
+#ifndef MIPI_DISPLAY_SPI_CLOCK_SPEED_HZ
+#define MIPI_DISPLAY_SPI_CLOCK_SPEED_HZ 62500000
+#endif
+
+struct PanelSinkStats
+{
+    uint32_t lines;  // Lines handed to the DMA
+    uint32_t bytes;  // Pixel bytes sent
+    uint32_t waitUs; // Time spent waiting for the DMA of the line before
+};
+
+// Take the SPI port over from pico-screens and set the column window.
+void panel_sink_start();
+
+// Wait for the last transfer and hand the SPI port back.
+void panel_sink_stop();
+
+// Send source row `line` (0: the first rendered row) of a rendered line,
+// if the downsampling keeps it. `pixels` may be reused on return.
+void panel_sink_send_line(int line, const uint16_t *pixels);
+
+// Running totals since boot.
+void panel_sink_get_stats(PanelSinkStats &stats);
+
+#if !PICO_ON_DEVICE
+#include <vector>
+
+struct PanelTransfer
+{
+    int row;                   // Panel row, without MIPI_DISPLAY_OFFSET_Y
+    uint32_t startUs;          // When the modelled DMA started
+    uint32_t endUs;            // When it is done
+    uint32_t waitUs;           // How long this line waited for the one before
+    std::vector<uint8_t> data; // The bytes on the wire
+};
+
+// Every transfer since panel_sink_start().
+const std::vector<PanelTransfer> &panel_sink_get_transfers();
+#endif
+
+#endif // PANEL_SINK_H
@@ -0,0 +1,48 @@
+#ifndef RGB444_H
+#define RGB444_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 12 bpp (RGB444) panel output.
+//
+// With SPI_SCREEN_RGB444 the NES palette holds 0x0RGB values instead of
+// RGB565, so the line and frame buffers carry 12-bit colours in 16-bit
+// slots. The panel sink ( panel_sink.h ) switches the panel to 12 bpp
+// while a game runs and packs two pixels into three bytes:
+//
+//   byte 0: R1 G1   byte 1: B1 R2   byte 2: G2 B2
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Pack `pixels` 0x0RGB values into `dst`. An odd trailing pixel is padded
+    // with black. Returns the number of bytes written.
+    static inline size_t rgb444_pack(const uint16_t *src, uint8_t *dst, size_t pixels)
+    {
+        uint8_t *p = dst;
+        for (size_t i = 0; i + 1 < pixels; i += 2)
+        {
+            uint16_t a = src[i] & 0x0fff;
+            uint16_t b = src[i + 1] & 0x0fff;
+            *p++ = (uint8_t)(a >> 4);
+            *p++ = (uint8_t)((a << 4) | (b >> 8));
+            *p++ = (uint8_t)b;
+        }
+        if (pixels & 1)
+        {
+            uint16_t a = src[pixels - 1] & 0x0fff;
+            *p++ = (uint8_t)(a >> 4);
+            *p++ = (uint8_t)(a << 4);
+            *p++ = 0;
+        }
+        return (size_t)(p - dst);
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RGB444_H
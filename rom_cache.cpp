@@ -0,0 +1,272 @@
+#include "rom_cache.h"
+
+#if defined(ROM_CACHE)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <algorithm>
+#include "pico/stdlib.h"
+#include "InfoNES.h"
+#include "InfoNES_System.h"
+#include "InfoNES_pAPU.h"
+
+#if PICO_ON_DEVICE
+// Highest heap address, the name is historical ( see the SDK linker scripts )
+extern "C" char __StackLimit;
+#endif
+
+namespace
+{
+    // Banks of one size from one flash region, copied into RAM slots on demand
+    struct BankPool
+    {
+        const BYTE *flash = nullptr;   // Bank 0 in flash
+        uint32_t size = 0;             // Bytes of all banks in flash
+        int shift = 0;                 // log2 of the bank size
+        int slots = 0;                 // 0: not cached
+        BYTE *ram = nullptr;           // The slots, followed by the tables below
+        uint32_t *mapped = nullptr;    // Sync the slot was last seen mapped at
+        int16_t *bankOfSlot = nullptr; // -1: free
+        int16_t *slotOfBank = nullptr; // -1: not in RAM
+    };
+
+    BYTE *wholeRom_;
+    BankPool prg_;
+    BankPool chr_;
+    uint32_t sync_;
+    RomCacheStats stats_;
+
+    // Largest block malloc() can still hand out: the free top chunk and what sbrk() has left
+    uint32_t freeHeap()
+    {
+#if PICO_ON_DEVICE
+        return (&__StackLimit - static_cast<char *>(sbrk(0))) + mallinfo().keepcost;
+#else
+        const char *s = getenv("ROM_CACHE_HEAP");
+        return s ? strtoul(s, nullptr, 0) : 512 * 1024;
+#endif
+    }
+
+    // Set up as many slots as the budget allows, up to maxSlots. Returns the bytes taken.
+    uint32_t poolInit(BankPool &pool, const BYTE *flash, uint32_t size, int shift,
+                      int maxSlots, int minSlots, uint32_t budget)
+    {
+        int banks = size >> shift;
+        uint32_t perSlot = (1u << shift) + sizeof(*pool.mapped) + sizeof(*pool.bankOfSlot);
+        uint32_t fixed = banks * sizeof(*pool.slotOfBank);
+        int count = budget > fixed ? std::min<uint32_t>(std::min(maxSlots, banks), (budget - fixed) / perSlot) : 0;
+        // Fewer slots than banks need room for the mapped ones and one to load into
+        if (count < std::min(minSlots, banks))
+        {
+            return 0;
+        }
+
+        uint32_t bytes = fixed + count * perSlot;
+        // freeHeap() is an estimate, malloc() may still refuse
+        pool.ram = static_cast<BYTE *>(malloc(bytes));
+        if (!pool.ram)
+        {
+            return 0;
+        }
+        pool.mapped = reinterpret_cast<uint32_t *>(pool.ram + (count << shift));
+        pool.bankOfSlot = reinterpret_cast<int16_t *>(pool.mapped + count);
+        pool.slotOfBank = pool.bankOfSlot + count;
+        std::fill_n(pool.mapped, count, 0);
+        std::fill_n(pool.bankOfSlot, count, -1);
+        std::fill_n(pool.slotOfBank, banks, -1);
+        pool.flash = flash;
+        pool.size = size;
+        pool.shift = shift;
+        pool.slots = count;
+        return bytes;
+    }
+
+    inline int __not_in_flash_func(slotOf)(const BankPool &pool, const BYTE *p)
+    {
+        uintptr_t ofs = reinterpret_cast<uintptr_t>(p) - reinterpret_cast<uintptr_t>(pool.ram);
+        return ofs < (static_cast<uintptr_t>(pool.slots) << pool.shift) ? static_cast<int>(ofs >> pool.shift) : -1;
+    }
+
+    // A free slot, else the least recently mapped one that nothing maps now, -1 if there is none
+    int __not_in_flash_func(poolVictim)(const BankPool &pool, int pinned)
+    {
+        int victim = -1;
+        for (int slot = 0; slot < pool.slots; ++slot)
+        {
+            if (pool.bankOfSlot[slot] < 0)
+            {
+                return slot;
+            }
+            if (pool.mapped[slot] != sync_ && slot != pinned &&
+                (victim < 0 || static_cast<int32_t>(pool.mapped[slot] - pool.mapped[victim]) < 0))
+            {
+                victim = slot;
+            }
+        }
+        return victim;
+    }
+
+    // Point the entries that map a flash bank at its copy in RAM. Without
+    // load, banks not in RAM stay in flash. A slot the entries or pinned
+    // point into is never reused, beforeReuse runs before a slot is
+    // overwritten with another bank.
+    void __not_in_flash_func(poolSync)(BankPool &pool, BYTE **entries, int count,
+                                       const BYTE *pinned, void (*beforeReuse)(), bool load)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            int slot = slotOf(pool, entries[i]);
+            if (slot >= 0)
+            {
+                pool.mapped[slot] = sync_;
+            }
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            uintptr_t ofs = reinterpret_cast<uintptr_t>(entries[i]) - reinterpret_cast<uintptr_t>(pool.flash);
+            if (ofs >= pool.size || (ofs & ((1u << pool.shift) - 1)))
+            {
+                continue; // RAM, or not on a bank boundary
+            }
+            int bank = ofs >> pool.shift;
+            int slot = pool.slotOfBank[bank];
+            if (slot >= 0)
+            {
+                ++stats_.hits;
+            }
+            else
+            {
+                if (!load)
+                {
+                    continue;
+                }
+                slot = poolVictim(pool, slotOf(pool, pinned));
+                if (slot < 0)
+                {
+                    continue; // Every slot is mapped, this bank stays in flash for now
+                }
+                if (pool.bankOfSlot[slot] >= 0)
+                {
+                    if (beforeReuse)
+                    {
+                        beforeReuse();
+                    }
+                    pool.slotOfBank[pool.bankOfSlot[slot]] = -1;
+                }
+                uint32_t start = time_us_32();
+                memcpy(pool.ram + (slot << pool.shift), pool.flash + ofs, 1u << pool.shift);
+                stats_.copyUs += time_us_32() - start;
+                ++stats_.misses;
+                pool.bankOfSlot[slot] = bank;
+                pool.slotOfBank[bank] = slot;
+            }
+            pool.mapped[slot] = sync_;
+            entries[i] = pool.ram + (slot << pool.shift);
+        }
+    }
+
+    // A reused CHR slot changes the tiles behind a PPUBANK pointer the PPU already saw
+    void __not_in_flash_func(beforeChrReuse)()
+    {
+#if defined(PPU_CORE1)
+        // Lines captured earlier may still read the slot
+        InfoNES_WaitDrawLine();
+#endif
+        // The pointer stays the same, the skipped line check must see new patterns
+        ++PatternGen;
+    }
+}
+
+void rom_cache_load()
+{
+    rom_cache_release();
+    stats_ = {};
+
+    uint32_t romSize = NesHeader.byRomSize * 0x4000;
+    uint32_t vromSize = NesHeader.byVRomSize * 0x2000;
+    uint32_t heap = freeHeap();
+    uint32_t budget = heap > ROM_CACHE_HEAP_RESERVE ? heap - ROM_CACHE_HEAP_RESERVE : 0;
+
+    // freeHeap() is an estimate, when malloc() refuses the bank cache gets a try
+    wholeRom_ = romSize + vromSize <= budget ? static_cast<BYTE *>(malloc(romSize + vromSize)) : nullptr;
+    if (wholeRom_)
+    {
+        memcpy(wholeRom_, ROM, romSize);
+        ROM = wholeRom_;
+        if (vromSize)
+        {
+            memcpy(wholeRom_ + romSize, VROM, vromSize);
+            VROM = wholeRom_ + romSize;
+        }
+        printf("ROM: %lu KB copied to RAM, %lu KB heap left\n",
+               (unsigned long)((romSize + vromSize) / 1024), (unsigned long)(freeHeap() / 1024));
+        return;
+    }
+
+    // PRG first, every opcode is fetched from it
+    budget -= poolInit(prg_, ROM, romSize, 13, ROM_CACHE_PRG_SLOTS, 5, budget);
+    if (vromSize)
+    {
+        poolInit(chr_, VROM, vromSize, 10, ROM_CACHE_CHR_SLOTS, 9, budget);
+    }
+    printf("ROM: caching %d of %lu PRG and %d of %lu CHR banks in RAM\n",
+           prg_.slots, (unsigned long)(romSize >> 13), chr_.slots, (unsigned long)(vromSize >> 10));
+}
+
+void rom_cache_release()
+{
+    free(wholeRom_);
+    wholeRom_ = nullptr;
+    free(prg_.ram);
+    prg_ = {};
+    free(chr_.ram);
+    chr_ = {};
+}
+
+void rom_cache_get_stats(RomCacheStats &stats)
+{
+    stats = stats_;
+}
+
+namespace
+{
+    void __not_in_flash_func(bankSync)(bool load)
+    {
+        if (!prg_.slots && !chr_.slots)
+        {
+            return;
+        }
+
+        if (load)
+        {
+            ++sync_;
+        }
+        if (prg_.slots)
+        {
+            // The DPCM channel streams from the bank it last resolved ( ApuC5Fetch ),
+            // on core 1 with APU_CORE1, keep that one until it moves on
+            poolSync(prg_, ROMBANK, 4, ApuC5Bank, nullptr, load);
+        }
+        if (chr_.slots)
+        {
+            // Pattern tables only, the few mappers that put VROM in a name table read it from flash
+            poolSync(chr_, PPUBANK, 8, nullptr, beforeChrReuse, load);
+        }
+    }
+}
+
+void __not_in_flash_func(InfoNES_BankSync)()
+{
+    bankSync(true);
+}
+
+void __not_in_flash_func(InfoNES_BankRemap)()
+{
+    // Called on mapper writes inside the CPU loop, an 8K copy there would stall
+    // the instruction, and reading flash until the line ends is still correct
+    bankSync(false);
+}
+#endif
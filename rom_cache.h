@@ -0,0 +1,55 @@
+#ifndef ROM_CACHE_H
+#define ROM_CACHE_H
+
+#include <stdint.h>
+
+// ROM residency: keeps the cartridge banks the emulator reads in RAM.
+//
+// parseROM() points ROM and VROM at the file in XIP flash, where every
+// opcode fetch, DPCM byte and pattern fetch can miss the 16K XIP cache.
+// rom_cache_load() picks one of three tiers for the loaded game:
+// - The whole ROM fits in the free heap: PRG and CHR are copied to RAM
+//   and ROM / VROM point at the copy, nothing else changes.
+// - It does not: ROM_CACHE_PRG_SLOTS 8K PRG and ROM_CACHE_CHR_SLOTS 1K
+//   CHR slots, or as many as fit, hold the banks mapped most recently.
+//   Mappers keep switching ROMBANK / PPUBANK to flash pointers.
+//   InfoNES_BankSync(), once per scanline, then points them at the RAM
+//   copy, loading the bank into the least recently mapped free slot on a
+//   miss. After a mapper write InfoNES_BankRemap() only redirects banks
+//   already in RAM, the copy waits for the end of the line.
+// - Not even that fits, or malloc() refuses: everything stays in flash.
+// A bank still read from flash is always correct, the copies only save
+// XIP stalls, so banks are redirected lazily.
+//
+// On the host (PICO_ON_DEVICE == 0) the free heap is 512K, or the bytes
+// given in ROM_CACHE_HEAP in the environment, to pick the other tiers.
+
+#ifndef ROM_CACHE_PRG_SLOTS
+#define ROM_CACHE_PRG_SLOTS 8 // 64K, at least 5 are needed: 4 mapped and one to load into
+#endif
+
+#ifndef ROM_CACHE_CHR_SLOTS
+#define ROM_CACHE_CHR_SLOTS 32 // 32K, at least 9 are needed: 8 mapped and one to load into
+#endif
+
+#ifndef ROM_CACHE_HEAP_RESERVE
+#define ROM_CACHE_HEAP_RESERVE (16 * 1024) // Heap left for the rest of the game session
+#endif
+
+struct RomCacheStats
+{
+    uint32_t hits;   // Bank switches to a bank already in RAM
+    uint32_t misses; // Banks copied from flash into a slot
+    uint32_t copyUs; // Time spent copying them, the CPU core stalls meanwhile
+};
+
+// Choose the tier for the ROM parseROM() just set up, before InfoNES_Reset().
+// Frees what the previous game used.
+void rom_cache_load();
+
+// Free the RAM copy, ROM and VROM must not be used any more.
+void rom_cache_release();
+
+void rom_cache_get_stats(RomCacheStats &stats);
+
+#endif // ROM_CACHE_H
@@ -0,0 +1,275 @@
+#include "scanout.h"
+
+#if defined(SCANOUT_QUEUE)
+#include <atomic>
+#include "pico/stdlib.h"
+#include "panel_sink.h"
+#include "InfoNES.h"
+#include "InfoNES_pAPU.h"
+
+#if PICO_ON_DEVICE
+#include "pico/multicore.h"
+#include "FrensHelpers.h"
+#else
+#include <thread>
+#endif
+
+namespace
+{
+    static_assert((SCANOUT_POOL_LINES & (SCANOUT_POOL_LINES - 1)) == 0,
+                  "SCANOUT_POOL_LINES must be a power of two");
+
+    // Width of the line buffers handed out by the backends
+    constexpr size_t LINE_WIDTH = 640;
+
+    // Lock-free ring with one producer core and one consumer core.
+    // Both indices only ever grow, so no read-modify-write is needed.
+    template <typename T>
+    class SpscQueue
+    {
+    public:
+        bool push(const T &v)
+        {
+            auto head = head_.load(std::memory_order_relaxed);
+            if (head - tail_.load(std::memory_order_acquire) == SCANOUT_POOL_LINES)
+            {
+                return false;
+            }
+            items_[head % SCANOUT_POOL_LINES] = v;
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T &v)
+        {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            if (tail == head_.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            v = items_[tail % SCANOUT_POOL_LINES];
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        uint32_t size() const
+        {
+            return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+        }
+
+    private:
+        T items_[SCANOUT_POOL_LINES];
+        std::atomic<uint32_t> head_{0};
+        std::atomic<uint32_t> tail_{0};
+    };
+
+    struct QueuedLine
+    {
+        int line;
+        ScreenOutput::LineBuffer *buffer;
+        bool render;
+    };
+
+    ScreenOutput::LineBuffer pool_[SCANOUT_POOL_LINES];
+#if defined(PPU_CORE1)
+    CapturedLine states_[SCANOUT_POOL_LINES]; // One per pool buffer
+#endif
+    SpscQueue<ScreenOutput::LineBuffer *> free_;  // core 1 -> core 0
+    SpscQueue<QueuedLine> filled_;                // core 0 -> core 1
+    bool started_ = false;
+    std::atomic<bool> running_{false}; // Core 1 keeps serving the queues
+#if !PICO_ON_DEVICE
+    std::thread core1_; // Core 1 is a thread on the host
+#endif
+
+    // Written by one core only, read by the other
+    volatile uint32_t linesSent_;
+    volatile uint32_t transferUs_;
+    uint32_t stalls_;
+    uint32_t stallUs_;
+    volatile uint32_t linesRendered_;
+    volatile uint32_t renderUs_;
+    volatile uint32_t audioUs_;
+    uint32_t linesCaptured_;
+    uint32_t waits_;
+
+    void __not_in_flash_func(core1Main)()
+    {
+        while (running_.load(std::memory_order_relaxed))
+        {
+#if defined(APU_CORE1)
+            // Audio batches come a few times per frame, they go before lines
+            uint32_t a0 = time_us_32();
+            if (InfoNES_pAPUService())
+            {
+                audioUs_ = audioUs_ + (time_us_32() - a0);
+                continue;
+            }
+#endif
+            QueuedLine q;
+            if (!filled_.pop(q))
+            {
+                // Woken by __sev() in scanout_submit_line()
+                __wfe();
+                continue;
+            }
+
+            uint32_t t0 = time_us_32();
+#if defined(PPU_CORE1)
+            if (q.render)
+            {
+                InfoNES_DrawLine(states_[q.buffer - pool_]);
+                linesRendered_ = linesRendered_ + 1;
+                __sev();
+                uint32_t t1 = time_us_32();
+                renderUs_ = renderUs_ + (t1 - t0);
+                t0 = t1;
+            }
+#endif
+            // The sink is done with the pool buffer once the DMA has its own copy
+            panel_sink_send_line(q.line, q.buffer->data());
+            transferUs_ = transferUs_ + (time_us_32() - t0);
+            linesSent_ = linesSent_ + 1;
+
+            free_.push(q.buffer);
+            __sev();
+        }
+    }
+
+#if PICO_ON_DEVICE
+    // What Frens::initAll() runs on core 1 for the screen backend, restarted
+    // after a game: its interrupts are registered on this core again and
+    // its line conversion loop resumes.
+    void backendCore1Main()
+    {
+        dvi_->registerIRQThisCore();
+        dvi_->waitForValidLine();
+        dvi_->start();
+        while (true)
+        {
+            dvi_->convertScanBuffer12bpp();
+        }
+    }
+#endif
+}
+
+void scanout_start()
+{
+    if (started_)
+    {
+        return;
+    }
+
+    for (auto &b : pool_)
+    {
+        b.resize(LINE_WIDTH);
+        free_.push(&b);
+    }
+
+    // The panel sink takes over from the backend for the game, its core 1
+    // loop is handed back in scanout_stop()
+    panel_sink_start();
+    running_ = true;
+#if PICO_ON_DEVICE
+    multicore_reset_core1();
+    multicore_launch_core1(core1Main);
+#else
+    core1_ = std::thread(core1Main);
+#endif
+    started_ = true;
+}
+
+void scanout_stop()
+{
+    if (!started_)
+    {
+        return;
+    }
+
+#if defined(APU_CORE1)
+    InfoNES_pAPUDrain();
+#endif
+    // Core 1 returns each buffer only after the backend is done with it
+    while (free_.size() != SCANOUT_POOL_LINES)
+    {
+        __wfe();
+    }
+    running_ = false;
+#if PICO_ON_DEVICE
+    multicore_reset_core1();
+    multicore_launch_core1(backendCore1Main);
+#else
+    core1_.join();
+#endif
+    panel_sink_stop();
+
+    // Take every buffer back so the next start finds an empty pool
+    ScreenOutput::LineBuffer *b;
+    while (free_.pop(b))
+    {
+    }
+    started_ = false;
+}
+
+ScreenOutput::LineBuffer *__not_in_flash_func(scanout_acquire_line)()
+{
+    ScreenOutput::LineBuffer *b;
+    if (!free_.pop(b))
+    {
+        uint32_t t0 = time_us_32();
+        while (!free_.pop(b))
+        {
+            // Woken by __sev() on core 1 when a buffer is returned
+            __wfe();
+        }
+        stallUs_ += time_us_32() - t0;
+        ++stalls_;
+    }
+    return b;
+}
+
+void __not_in_flash_func(scanout_submit_line)(int line, ScreenOutput::LineBuffer *buffer, bool render)
+{
+    if (render)
+    {
+        ++linesCaptured_;
+    }
+    // Never full: the queue holds as many entries as there are pool buffers
+    filled_.push({line, buffer, render});
+    __sev();
+}
+
+#if defined(PPU_CORE1)
+CapturedLine *__not_in_flash_func(scanout_line_state)(ScreenOutput::LineBuffer *buffer)
+{
+    return &states_[buffer - pool_];
+}
+
+void __not_in_flash_func(scanout_wait_rendered)()
+{
+    if (linesRendered_ == linesCaptured_)
+    {
+        return;
+    }
+    ++waits_;
+    while (linesRendered_ != linesCaptured_)
+    {
+        // Woken by __sev() on core 1 after each rendered line
+        __wfe();
+    }
+}
+#endif
+
+void scanout_get_stats(ScanoutStats &stats)
+{
+    stats.linesSent = linesSent_;
+    stats.stalls = stalls_;
+    stats.stallUs = stallUs_;
+    stats.transferUs = transferUs_;
+    stats.linesRendered = linesRendered_;
+    stats.renderUs = renderUs_;
+    stats.waits = waits_;
+    stats.audioUs = audioUs_;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SCANOUT_H
+#define SCANOUT_H
+
+#include <stdint.h>
+#include "screen_output.h"
+
+// Pipelined scan-out for the SPI screen.
+//
+// Core 0 renders into a small pool of line buffers and queues each finished
+// line. Core 1 hands each one to the panel sink ( see panel_sink.h ): line
+// N is downsampled there while core 0 renders line N+1, and goes out over
+// DMA while line N+1 is downsampled.
+// When every pool buffer is in flight core 0 waits (back-pressure) and the
+// time spent waiting is counted as a stall.
+// Core 1 belongs to the screen backend outside games ( Frens::initAll()
+// starts its loop there ). scanout_start() resets core 1 and runs the
+// scan-out loop on it, scanout_stop() resets it again and restarts the
+// backend's loop through the ScreenOutput interface.
+//
+// With PPU_CORE1 core 0 may queue a line as a captured PPU state instead of
+// pixels ( see InfoNES_CaptureLine ), core 1 then renders it into the line
+// buffer before sending it.
+// With APU_CORE1 core 1 also renders the audio batches the APU publishes
+// ( see InfoNES_pAPUService ).
+
+#ifndef SCANOUT_POOL_LINES
+#define SCANOUT_POOL_LINES 4 // Must be a power of two
+#endif
+
+struct ScanoutStats
+{
+    uint32_t linesSent;      // Lines handed to the panel sink by core 1
+    uint32_t stalls;         // Times core 0 had to wait for a free buffer
+    uint32_t stallUs;        // Total time core 0 waited
+    uint32_t transferUs;     // Total time core 1 spent in the panel sink
+    uint32_t linesRendered;  // Captured lines rendered by core 1
+    uint32_t renderUs;       // Total time core 1 spent rendering them
+    uint32_t waits;          // Times core 0 waited for the captured lines before a PPU memory write
+    uint32_t audioUs;        // Total time core 1 spent rendering audio batches
+};
+
+struct CapturedLine;
+
+// Start the core 1 service loop. Must be called before the first line is rendered.
+void scanout_start();
+
+// Wait until every queued line has been sent, then hand core 1 back to the backend.
+void scanout_stop();
+
+// Get a free line buffer to render into (core 0).
+ScreenOutput::LineBuffer *scanout_acquire_line();
+
+// Queue a line for transfer (core 0). render: the line was captured into
+// scanout_line_state(buffer) and core 1 renders it first.
+void scanout_submit_line(int line, ScreenOutput::LineBuffer *buffer, bool render = false);
+
+// Capture slot that travels with an acquired line buffer (core 0).
+CapturedLine *scanout_line_state(ScreenOutput::LineBuffer *buffer);
+
+// Wait until core 1 has rendered every captured line queued so far (core 0).
+void scanout_wait_rendered();
+
+// Running totals since scanout_start().
+void scanout_get_stats(ScanoutStats &stats);
+
+#endif // SCANOUT_H
@@ -0,0 +1,72 @@
+#ifndef SCREEN_DISPATCH_H
+#define SCREEN_DISPATCH_H
+
+#include <type_traits>
+#include "pico.h"
+#include "FrensHelpers.h" // Provides the global dvi_ pointer
+#include "screen_output.h"
+
+// Compile-time dispatch to the screen backend for the per-line and
+// per-sample calls.
+//
+// dvi_ is a ScreenOutput*, so every call through it is a virtual call that
+// loads the vtable from flash. When SCREEN_BACKEND_CLASS names the concrete
+// backend type the calls below are qualified and bind statically, so they
+// can be inlined. Without it they fall back to the virtual interface. The
+// menu code keeps using dvi_ directly.
+// DVI builds name dvi::DVI, the host checks host::Screen ( host/ ). On SPI
+// builds the game's lines go to the panel sink instead ( SCANOUT_QUEUE,
+// scanout.h ), plain function calls, and SPI_SCREEN_BACKEND_CLASS may name
+// the pico-screens class for the rest.
+
+namespace screen
+{
+#if defined(SCREEN_BACKEND_CLASS)
+    using Backend = SCREEN_BACKEND_CLASS;
+#else
+    using Backend = ScreenOutput;
+#endif
+    static_assert(std::is_base_of<ScreenOutput, Backend>::value,
+                  "SCREEN_BACKEND_CLASS must implement ScreenOutput");
+
+    constexpr bool isStatic = !std::is_same<Backend, ScreenOutput>::value;
+
+    __force_inline Backend *backend()
+    {
+        return static_cast<Backend *>(dvi_);
+    }
+
+    __force_inline ScreenOutput::LineBuffer *getLineBuffer()
+    {
+        if constexpr (isStatic)
+            return backend()->Backend::getLineBuffer();
+        else
+            return backend()->getLineBuffer();
+    }
+
+    __force_inline void setLineBuffer(int line, ScreenOutput::LineBuffer *p)
+    {
+        if constexpr (isStatic)
+            backend()->Backend::setLineBuffer(line, p);
+        else
+            backend()->setLineBuffer(line, p);
+    }
+
+    __force_inline uint32_t getFrameCounter()
+    {
+        if constexpr (isStatic)
+            return backend()->Backend::getFrameCounter();
+        else
+            return backend()->getFrameCounter();
+    }
+
+    __force_inline util::RingBuffer<ScreenOutput::AudioSample> &getAudioRingBuffer()
+    {
+        if constexpr (isStatic)
+            return backend()->Backend::getAudioRingBuffer();
+        else
+            return backend()->getAudioRingBuffer();
+    }
+}
+
+#endif // SCREEN_DISPATCH_H
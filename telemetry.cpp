@@ -0,0 +1,209 @@
+#include "telemetry.h"
+#include <stdio.h>
+#include <algorithm>
+#include "InfoNES.h"
+#include "scanout.h"
+#include "panel_sink.h"
+#include "audio.h"
+#include "audio_sink.h"
+#include "input.h"
+#include "rom_cache.h"
+#include "xip_stats.h"
+#if PICO_RP2040
+#include "hardware/structs/busctrl.h"
+#endif
+
+static constexpr uint32_t REPORT_INTERVAL_US = 1000000;
+
+static uint32_t last_report_us = 0;
+static uint32_t frames = 0;
+static uint32_t last_frame_us = 0;
+static uint32_t idle_total_us = 0;
+static uint32_t idle_min_pct = 100;
+#if defined(SCANOUT_QUEUE)
+static ScanoutStats last_scanout = {};
+static PanelSinkStats last_panel = {};
+#endif
+static AudioStats last_audio = {};
+static InputStats last_input = {};
+#if defined(ROM_CACHE)
+static RomCacheStats last_rom = {};
+#endif
+#if defined(AUDIO_SINK)
+static uint32_t last_starved = 0;
+#endif
+#if defined(XIP_STATS)
+static XipStats last_xip = {};
+static const char *const xip_phase_names[XIP_PHASE_COUNT] = {"other", "cpu", "apu", "bg", "sprite"};
+#endif
+#if PICO_RP2040
+// Bus fabric accesses that waited for another master on the same bank.
+// Every bank has its own arbiter and there are only four counters, so
+// reports alternate between two groups, each counted every other second:
+// the striped main banks SRAM0-3, and scratch X ( core 1 stack ), scratch
+// Y ( core 0 stack and SCRATCH_STATE ) with all its accesses, and XIP.
+// The main figure of a SCRATCH_STATE build against one without it is
+// the contention the scratch placement saves.
+static const uint32_t bus_events[2][4] = {
+    {
+        arbiter_sram0_perf_event_access_contested,
+        arbiter_sram1_perf_event_access_contested,
+        arbiter_sram2_perf_event_access_contested,
+        arbiter_sram3_perf_event_access_contested,
+    },
+    {
+        arbiter_sram4_perf_event_access_contested,
+        arbiter_sram5_perf_event_access_contested,
+        arbiter_sram5_perf_event_access,
+        arbiter_xip_main_perf_event_access_contested,
+    },
+};
+static int bus_group = -1; // Group the counters count, -1: none yet
+#endif
+
+void telemetry_frame(uint32_t now_us, uint32_t idle_us)
+{
+    ++frames;
+    // Share of the frame the CPU core slept, the least of any frame is the headroom left
+    uint32_t frame_us = now_us - last_frame_us;
+    if (frame_us)
+    {
+        idle_min_pct = std::min<uint32_t>(idle_min_pct, idle_us * 100 / frame_us);
+    }
+    last_frame_us = now_us;
+    idle_total_us += idle_us;
+    if (now_us - last_report_us < REPORT_INTERVAL_US)
+    {
+        return;
+    }
+
+    printf("[TEL] frames %lu idle %lu%% min %lu%%", (unsigned long)frames,
+           (unsigned long)((uint64_t)idle_total_us * 100 / (now_us - last_report_us)),
+           (unsigned long)idle_min_pct);
+    idle_total_us = 0;
+    idle_min_pct = 100;
+#if defined(DIRTY_LINES)
+    // Lines whose inputs matched the previous frame and were not rendered
+    printf(" lines skipped %lu redrawn %lu",
+           (unsigned long)DirtyLineHits, (unsigned long)DirtyLineMisses);
+    DirtyLineHits = 0;
+    DirtyLineMisses = 0;
+#endif
+#if defined(SCANOUT_QUEUE)
+    // Core 0 waiting for a free line buffer vs. core 1 busy sending lines,
+    // of that the time the panel sink waited for the DMA of the line before
+    ScanoutStats s;
+    scanout_get_stats(s);
+    printf(" scanout lines %lu stalls %lu (%lu us) transfer %lu us",
+           (unsigned long)(s.linesSent - last_scanout.linesSent),
+           (unsigned long)(s.stalls - last_scanout.stalls),
+           (unsigned long)(s.stallUs - last_scanout.stallUs),
+           (unsigned long)(s.transferUs - last_scanout.transferUs));
+    PanelSinkStats p;
+    panel_sink_get_stats(p);
+    printf(" (dma wait %lu us, %lu bytes)",
+           (unsigned long)(p.waitUs - last_panel.waitUs),
+           (unsigned long)(p.bytes - last_panel.bytes));
+    last_panel = p;
+#if defined(PPU_CORE1)
+    // Lines rendered on core 1, and core 0 waiting for them before PPU memory writes
+    printf(" rendered %lu (%lu us) waits %lu",
+           (unsigned long)(s.linesRendered - last_scanout.linesRendered),
+           (unsigned long)(s.renderUs - last_scanout.renderUs),
+           (unsigned long)(s.waits - last_scanout.waits));
+#endif
+#if defined(APU_CORE1)
+    printf(" apu %lu us", (unsigned long)(s.audioUs - last_scanout.audioUs));
+#endif
+    last_scanout = s;
+#endif
+    // Ring fill and the sample rate trim keeping it there ( ppm )
+    AudioStats a;
+    audio_get_stats(a);
+    if (a.capacity)
+    {
+        printf(" audio fill %ld%% trim %ld ppm under %lu over %lu",
+               (long)(a.fill * 100 / a.capacity),
+               (long)((int64_t)a.trim * 1000000 / 65536),
+               (unsigned long)(a.underruns - last_audio.underruns),
+               (unsigned long)(a.overruns - last_audio.overruns));
+    }
+    last_audio = a;
+#if defined(AUDIO_SINK)
+    // Frames the PWM sink repeated because the ring was empty
+    uint32_t starved = audio_sink_get_starved();
+    printf(" starved %lu", (unsigned long)(starved - last_starved));
+    last_starved = starved;
+#endif
+    // Button change to the game's latch, and on to the end of the frame showing it
+    InputStats in;
+    input_get_stats(in);
+    uint32_t samples = in.samples - last_input.samples;
+    if (samples)
+    {
+        printf(" input latch %lu us frame %lu us",
+               (unsigned long)((in.latchUs - last_input.latchUs) / samples),
+               (unsigned long)((in.latencyUs - last_input.latencyUs) / samples));
+    }
+    last_input = in;
+#if defined(ROM_CACHE)
+    // Bank switches served from RAM, banks copied in from flash and the time that took
+    RomCacheStats rom;
+    rom_cache_get_stats(rom);
+    if (rom.hits != last_rom.hits || rom.misses != last_rom.misses)
+    {
+        printf(" rom hits %lu misses %lu copy %lu us",
+               (unsigned long)(rom.hits - last_rom.hits),
+               (unsigned long)(rom.misses - last_rom.misses),
+               (unsigned long)(rom.copyUs - last_rom.copyUs));
+    }
+    last_rom = rom;
+#endif
+#if defined(XIP_STATS)
+    // XIP cache hit rate and misses of each work phase
+    XipStats xip;
+    xip_stats_get(xip);
+    printf(" xip");
+    for (int i = 0; i < XIP_PHASE_COUNT; ++i)
+    {
+        uint32_t hits = xip.phase[i].hits - last_xip.phase[i].hits;
+        uint32_t accesses = xip.phase[i].accesses - last_xip.phase[i].accesses;
+        uint32_t permille = accesses ? (uint64_t)hits * 1000 / accesses : 1000;
+        printf(" %s %lu.%lu%% miss %lu", xip_phase_names[i],
+               (unsigned long)(permille / 10), (unsigned long)(permille % 10),
+               (unsigned long)(accesses - hits));
+    }
+    last_xip = xip;
+#endif
+#if PICO_RP2040
+    // Contested accesses since the previous report, the counters saturate at 2^24
+    uint32_t bus[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        bus[i] = bus_ctrl_hw->counter[i].value;
+    }
+    if (bus_group == 0)
+    {
+        printf(" bus contested main %lu (%lu %lu %lu %lu)",
+               (unsigned long)(bus[0] + bus[1] + bus[2] + bus[3]),
+               (unsigned long)bus[0], (unsigned long)bus[1],
+               (unsigned long)bus[2], (unsigned long)bus[3]);
+    }
+    else if (bus_group == 1)
+    {
+        printf(" bus contested x %lu y %lu of %lu xip %lu",
+               (unsigned long)bus[0], (unsigned long)bus[1],
+               (unsigned long)bus[2], (unsigned long)bus[3]);
+    }
+    bus_group = bus_group == 0 ? 1 : 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        bus_ctrl_hw->counter[i].sel = bus_events[bus_group][i];
+        bus_ctrl_hw->counter[i].value = 0; // Any write clears
+    }
+#endif
+    printf("\n");
+
+    frames = 0;
+    last_report_us = now_us;
+}
@@ -0,0 +1,11 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// Called once per emulated frame while the frame rate overlay is enabled,
+// idle_us is the time the frame pacing slept since the previous call.
+// Prints a "[TEL]" line with the emulator counters about once per second.
+void telemetry_frame(uint32_t now_us, uint32_t idle_us);
+
+#endif // TELEMETRY_H
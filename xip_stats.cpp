@@ -0,0 +1,190 @@
+#include "xip_stats.h"
+
+#if defined(XIP_STATS)
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "pico/stdlib.h"
+#include "InfoNES.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/structs/xip_ctrl.h"
+#else
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#endif
+
+namespace
+{
+    XipStats totals_;
+    XipPhaseStats frame_[XIP_PHASE_COUNT]; // The frame so far
+    uint32_t lastHits_;                     // Counters at the previous phase end
+    uint32_t lastAccesses_;
+    uint32_t frameHitPct_ = 100;
+
+#if !PICO_ON_DEVICE
+    // Set associative, least recently used way replaced
+    struct CacheModel
+    {
+        int lineShift = 0;
+        int sets = 0;
+        int ways = 0;
+        std::vector<uint32_t> lines; // sets * ways, line + 1 ( 0: empty ), most recent first
+        uint32_t hits = 0;
+        uint32_t accesses = 0;
+    };
+
+    CacheModel model_;
+    const BYTE *flash_; // parseROM()'s ROM, VROM follows it
+    uintptr_t flashSize_;
+    std::thread::id emuThread_;
+
+    int envOr(const char *name, int value)
+    {
+        const char *s = getenv(name);
+        return s && atoi(s) > 0 ? atoi(s) : value;
+    }
+
+    void modelInit()
+    {
+        int size = envOr("XIP_MODEL_SIZE", XIP_MODEL_SIZE);
+        int ways = envOr("XIP_MODEL_WAYS", XIP_MODEL_WAYS);
+        int line = envOr("XIP_MODEL_LINE", XIP_MODEL_LINE);
+        model_ = {};
+        while ((2 << model_.lineShift) <= line)
+        {
+            ++model_.lineShift;
+        }
+        model_.ways = ways;
+        model_.sets = std::max(1, (size >> model_.lineShift) / ways);
+        model_.lines.assign(model_.sets * ways, 0);
+        printf("XIP model: %d sets of %d ways, %d byte lines\n",
+               model_.sets, model_.ways, 1 << model_.lineShift);
+    }
+
+    void modelAccess(uintptr_t ofs)
+    {
+        uint32_t line = static_cast<uint32_t>(ofs >> model_.lineShift) + 1;
+        uint32_t *row = &model_.lines[(line % model_.sets) * model_.ways];
+        int way = 0;
+        while (way < model_.ways - 1 && row[way] != line)
+        {
+            ++way;
+        }
+        ++model_.accesses;
+        if (row[way] == line)
+        {
+            ++model_.hits;
+        }
+        // A miss evicts the last way
+        memmove(row + 1, row, way * sizeof(*row));
+        row[0] = line;
+    }
+#endif
+
+    inline bool __not_in_flash_func(onEmulationThread)()
+    {
+#if PICO_ON_DEVICE
+        // PPU_CORE1 draws deferred lines on core 1, its marks are not ours
+        return get_core_num() == 0;
+#else
+        return std::this_thread::get_id() == emuThread_;
+#endif
+    }
+
+    inline void __not_in_flash_func(readCounters)(uint32_t &hits, uint32_t &accesses)
+    {
+#if PICO_ON_DEVICE
+        // Hits first, an access in between cannot make them exceed the accesses
+        hits = xip_ctrl_hw->ctr_hit;
+        accesses = xip_ctrl_hw->ctr_acc;
+#else
+        hits = model_.hits;
+        accesses = model_.accesses;
+#endif
+    }
+
+    void __not_in_flash_func(clearCounters)()
+    {
+#if PICO_ON_DEVICE
+        // Any write clears, they saturate instead of wrapping
+        xip_ctrl_hw->ctr_hit = 0;
+        xip_ctrl_hw->ctr_acc = 0;
+#else
+        model_.hits = 0;
+        model_.accesses = 0;
+#endif
+        lastHits_ = 0;
+        lastAccesses_ = 0;
+    }
+}
+
+void xip_stats_load()
+{
+#if !PICO_ON_DEVICE
+    emuThread_ = std::this_thread::get_id();
+    flash_ = ROM;
+    flashSize_ = NesHeader.byRomSize * 0x4000 + NesHeader.byVRomSize * 0x2000;
+    modelInit();
+#endif
+    memset(frame_, 0, sizeof(frame_));
+    clearCounters();
+}
+
+void __not_in_flash_func(xip_stats_frame)()
+{
+    InfoNES_XipPhase(XIP_PHASE_OTHER);
+
+    uint32_t hits = 0;
+    uint32_t accesses = 0;
+    for (int i = 0; i < XIP_PHASE_COUNT; ++i)
+    {
+        hits += frame_[i].hits;
+        accesses += frame_[i].accesses;
+        totals_.phase[i].hits += frame_[i].hits;
+        totals_.phase[i].accesses += frame_[i].accesses;
+    }
+    ++totals_.frames;
+    frameHitPct_ = accesses ? static_cast<uint32_t>(static_cast<uint64_t>(hits) * 100 / accesses) : 100;
+    memset(frame_, 0, sizeof(frame_));
+    clearCounters();
+}
+
+void xip_stats_get(XipStats &stats)
+{
+    stats = totals_;
+}
+
+uint32_t xip_stats_frame_hit_pct()
+{
+    return frameHitPct_;
+}
+
+void __not_in_flash_func(InfoNES_XipPhase)(int nPhase)
+{
+    if (!onEmulationThread())
+    {
+        return;
+    }
+    uint32_t hits;
+    uint32_t accesses;
+    readCounters(hits, accesses);
+    frame_[nPhase].hits += hits - lastHits_;
+    frame_[nPhase].accesses += accesses - lastAccesses_;
+    lastHits_ = hits;
+    lastAccesses_ = accesses;
+}
+
+#if !PICO_ON_DEVICE
+void InfoNES_XipRead(const void *pAddr)
+{
+    // RAM copies ( ROM_CACHE ) and PPURAM are not in flash
+    uintptr_t ofs = reinterpret_cast<uintptr_t>(pAddr) - reinterpret_cast<uintptr_t>(flash_);
+    if (ofs < flashSize_ && model_.sets && onEmulationThread())
+    {
+        modelAccess(ofs);
+    }
+}
+#endif
+#endif
@@ -0,0 +1,64 @@
+#ifndef XIP_STATS_H
+#define XIP_STATS_H
+
+#include <stdint.h>
+#include "InfoNES_System.h"
+
+// XIP cache counters, split by emulation phase.
+//
+// Every read from flash that misses the 16K XIP cache stalls the core
+// for a QSPI transfer: ROMBANK opcode and DPCM reads, PPUBANK pattern
+// fetches and code that is not __not_in_flash_func. On the device the
+// XIP controller counts its hits and accesses ( CTR_HIT / CTR_ACC ).
+// The core calls InfoNES_XipPhase() next to each work meter mark, the
+// accesses since the previous mark are charged to the phase that just
+// ended ( XIP_PHASE_* in InfoNES_System.h ). xip_stats_frame() closes
+// the frame and clears the counters before they saturate.
+// The counters see every master, so core 1 and DMA reads from flash
+// during a phase are charged to it as well.
+//
+// On the host (PICO_ON_DEVICE == 0) there is no XIP cache. The core then
+// reports its ROM, DPCM and pattern reads through InfoNES_XipRead() and a
+// set associative LRU cache model counts those that fall in the ROM image
+// xip_stats_load() saw, code fetches are not modelled. The geometry comes
+// from XIP_MODEL_SIZE / XIP_MODEL_WAYS / XIP_MODEL_LINE in the environment,
+// else the defaults below, which match the RP2040.
+
+#ifndef XIP_MODEL_SIZE
+#define XIP_MODEL_SIZE (16 * 1024) // Bytes
+#endif
+
+#ifndef XIP_MODEL_WAYS
+#define XIP_MODEL_WAYS 2
+#endif
+
+#ifndef XIP_MODEL_LINE
+#define XIP_MODEL_LINE 8 // Bytes
+#endif
+
+struct XipPhaseStats
+{
+    uint32_t hits;
+    uint32_t accesses;
+};
+
+struct XipStats
+{
+    XipPhaseStats phase[XIP_PHASE_COUNT];
+    uint32_t frames;
+};
+
+// Note where the ROM parseROM() just set up lies in flash, before
+// rom_cache_load() moves it. Resets the host cache model.
+void xip_stats_load();
+
+// Close the emulated frame: the rest goes to XIP_PHASE_OTHER.
+void xip_stats_frame();
+
+// Totals since boot, they wrap like the other telemetry counters.
+void xip_stats_get(XipStats &stats);
+
+// Share of the previous frame's accesses that hit, in percent, 100 without any.
+uint32_t xip_stats_frame_hit_pct();
+
+#endif // XIP_STATS_H